@@ -0,0 +1,238 @@
+// g++ -std=c++20 -O2 -DBOOST_BEAST_USE_STD_STRING_VIEW -I.. connection_churn_bench.cpp ../slab_pool.cpp ../timeout_service.cpp ../timing_wheel.cpp -pthread
+// Backend sessions opened, served and closed back to back with their timeouts armed, alone and next to
+// as many idle sessions as the descriptor limit allows. Then what the timeouts themselves cost at 100k
+// and 1M connections: an entry of the timing wheel against an asio timer per connection.
+#include "../shard_router.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <thread>
+
+#include <sys/resource.h>
+
+namespace {
+
+    namespace net = boost::asio;
+    namespace http = boost::beast::http;
+    using Clock = std::chrono::steady_clock;
+
+    const int CHURN_CONNECTIONS {20000};
+    const int CLIENT_THREADS {4};
+    const int BACKEND_THREADS {2};
+    const size_t MAX_IDLE_SESSIONS {100000u};
+    const size_t RESERVED_DESCRIPTORS {256u};
+    const std::array<size_t, 2> WHEEL_CONNECTIONS {100000u, 1000000u};
+    const std::chrono::milliseconds EXPIRY_TIMEOUT {300};
+
+    struct EchoHandler {
+        template <typename Request, typename Send>
+        void operator() (Request &&request, Send &&send) const {
+            types::response::Str response;
+            response.result(http::status::ok);
+            response.body() = R"({"id":"map1"})";
+            response.keep_alive(request.keep_alive());
+            response.prepare_payload();
+            send(types::HttpResponse {std::move(response)});
+        }
+    };
+
+    struct Percentiles {
+        Clock::duration p50, p99, max;
+    };
+
+    Percentiles Of (std::vector<Clock::duration> &samples) {
+        std::sort(samples.begin(), samples.end());
+        const auto at = [&samples](double q) {
+            return samples[static_cast<size_t>(q * static_cast<double>(samples.size() - 1))];
+        };
+        return {at(0.5), at(0.99), samples.back()};
+    }
+
+    long long Us (Clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+    }
+
+    // connect, one request with Connection: close, read the answer, close; per connection
+    struct Churn {
+        double per_second;
+        Percentiles latency;
+    };
+
+    Churn RunChurn (const sharding::fs::path &socket_path) {
+        net::io_context ioc;    // blocking sockets only, never run
+        std::vector<std::vector<Clock::duration>> samples(CLIENT_THREADS);
+        std::atomic<int> failed {0};
+        std::vector<std::thread> clients;
+        const auto start = Clock::now();
+        for (int t = 0; t < CLIENT_THREADS; ++t) {
+            clients.emplace_back([&, t] {
+                for (int i = 0; i < CHURN_CONNECTIONS / CLIENT_THREADS; ++i) {
+                    const auto connect_start = Clock::now();
+                    sharding::local::socket socket(ioc);
+                    boost::beast::error_code ec;
+                    socket.connect(sharding::local::endpoint(socket_path.string()), ec);
+                    http::request<http::string_body> request {http::verb::get, "/api/v1/maps/map1", 11};
+                    request.keep_alive(false);
+                    boost::beast::flat_buffer buffer;
+                    http::response<http::string_body> response;
+                    if (not ec) http::write(socket, request, ec);
+                    if (not ec) http::read(socket, buffer, response, ec);
+                    if (ec || response.result() != http::status::ok) ++failed;
+                    socket.close(ec);
+                    samples[t].push_back(Clock::now() - connect_start);
+                }
+            });
+        }
+        for (auto &client : clients) client.join();
+        const auto elapsed = std::chrono::duration<double>(Clock::now() - start);
+        if (failed != 0) std::abort();
+
+        std::vector<Clock::duration> all;
+        for (const auto &thread_samples : samples) all.insert(all.end(), thread_samples.begin(), thread_samples.end());
+        return {static_cast<double>(all.size()) / elapsed.count(), Of(all)};
+    }
+
+    // Two descriptors per idle session (client and server end), what is left after raising the soft limit
+    size_t IdleSessionBudget () {
+        rlimit limit {};
+        ::getrlimit(RLIMIT_NOFILE, &limit);
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+        ::getrlimit(RLIMIT_NOFILE, &limit);
+        const size_t descriptors = static_cast<size_t>(limit.rlim_cur);
+        if (descriptors <= RESERVED_DESCRIPTORS) return 0u;
+        return std::min(MAX_IDLE_SESSIONS, (descriptors - RESERVED_DESCRIPTORS) / 2u);
+    }
+
+    struct TimerCost {
+        Clock::duration arm, rearm, disarm;     // per connection
+        Percentiles lateness;                   // of the expiry, past the timeout
+    };
+
+    template <typename Fn>
+    Clock::duration PerConnection (size_t connections, Fn &&fn) {
+        const auto start = Clock::now();
+        for (size_t i = 0; i < connections; ++i) fn(i);
+        return (Clock::now() - start) / connections;
+    }
+
+    // What sessions do: arm on accept, rearm on every request, disarm on close
+    TimerCost WheelCost (size_t connections) {
+        TimerCost cost {};
+        net::io_context ioc;
+        auto timeouts = std::make_shared<timers::TimeoutService>(ioc, sharding::const_values::TIMEOUT_TICK);
+        std::vector<timers::TimingWheel::TimerId> ids(connections);
+        cost.arm = PerConnection(connections, [&](size_t i) {
+            ids[i] = timeouts->Arm(sharding::const_values::IDLE_TIMEOUT, [] {});
+        });
+        cost.rearm = PerConnection(connections, [&](size_t i) {
+            timeouts->Rearm(ids[i], sharding::const_values::IDLE_TIMEOUT);
+        });
+        cost.disarm = PerConnection(connections, [&](size_t i) { timeouts->Disarm(ids[i]); });
+
+        // ticking while the timers are armed, as in a running server
+        net::io_context expiry_ioc;
+        auto expiries = std::make_shared<timers::TimeoutService>(expiry_ioc, sharding::const_values::TIMEOUT_TICK);
+        expiries->Start();
+        std::vector<Clock::duration> lateness;
+        lateness.reserve(connections);
+        std::thread ticker([&expiry_ioc] { expiry_ioc.run(); });
+        for (size_t i = 0; i < connections; ++i) {
+            const auto deadline = Clock::now() + EXPIRY_TIMEOUT;
+            expiries->Arm(EXPIRY_TIMEOUT, [&, deadline, connections] {
+                lateness.push_back(Clock::now() - deadline);
+                if (lateness.size() == connections) expiries->Stop();
+            });
+        }
+        ticker.join();
+        cost.lateness = Of(lateness);
+        return cost;
+    }
+
+    TimerCost AsioTimerCost (size_t connections) {
+        TimerCost cost {};
+        net::io_context ioc;
+        std::deque<net::steady_timer> timers;
+        cost.arm = PerConnection(connections, [&](size_t) {
+            timers.emplace_back(ioc, sharding::const_values::IDLE_TIMEOUT).async_wait([](boost::system::error_code) {});
+        });
+        cost.rearm = PerConnection(connections, [&](size_t i) {
+            timers[i].expires_after(sharding::const_values::IDLE_TIMEOUT);
+            timers[i].async_wait([](boost::system::error_code) {});
+        });
+        cost.disarm = PerConnection(connections, [&](size_t i) { timers[i].cancel(); });
+        ioc.run();      // the aborted waits
+        ioc.restart();
+
+        std::vector<Clock::duration> lateness;
+        lateness.reserve(connections);
+        for (size_t i = 0; i < connections; ++i) {
+            const auto deadline = Clock::now() + EXPIRY_TIMEOUT;
+            timers[i].expires_after(EXPIRY_TIMEOUT);
+            timers[i].async_wait([&lateness, deadline](boost::system::error_code) {
+                lateness.push_back(Clock::now() - deadline);
+            });
+        }
+        ioc.run();
+        cost.lateness = Of(lateness);
+        return cost;
+    }
+
+    void Print (std::string_view name, const TimerCost &cost) {
+        std::cout << "  " << name << ": arm " << std::chrono::nanoseconds(cost.arm).count()
+                  << " ns, rearm " << std::chrono::nanoseconds(cost.rearm).count()
+                  << " ns, disarm " << std::chrono::nanoseconds(cost.disarm).count()
+                  << " ns; expiry late by p50 " << Us(cost.lateness.p50) << " us, p99 " << Us(cost.lateness.p99)
+                  << " us, max " << Us(cost.lateness.max) << " us" << std::endl;
+    }
+
+    void Print (std::string_view name, const Churn &churn) {
+        std::cout << name << static_cast<long long>(churn.per_second) << " connections/s, p50 "
+                  << Us(churn.latency.p50) << " us, p99 " << Us(churn.latency.p99)
+                  << " us, max " << Us(churn.latency.max) << " us" << std::endl;
+    }
+
+}//!namespace
+
+int main () {
+    const auto dir = sharding::fs::temp_directory_path() / ("churn_bench_" + std::to_string(std::random_device{}()));
+    sharding::fs::create_directories(dir);
+    const auto socket_path = dir / "backend.sock";
+    const size_t idle_sessions = IdleSessionBudget();
+
+    net::io_context backend_ioc;
+    EchoHandler handler;
+    std::make_shared<sharding::BackendListener<EchoHandler>>(backend_ioc, socket_path, handler)->Run();
+    std::vector<std::thread> backend_threads;
+    for (int i = 0; i < BACKEND_THREADS; ++i) backend_threads.emplace_back([&] { backend_ioc.run(); });
+
+    std::cout << CHURN_CONNECTIONS << " connections, " << CLIENT_THREADS << " clients, "
+              << BACKEND_THREADS << " backend threads" << std::endl;
+    Print("churn:                    ", RunChurn(socket_path));
+
+    // connected and silent: every one of them holds a session and its first request timeout
+    net::io_context client_ioc;
+    std::vector<sharding::local::socket> idle;
+    idle.reserve(idle_sessions);
+    for (size_t i = 0; i < idle_sessions; ++i) {
+        idle.emplace_back(client_ioc).connect(sharding::local::endpoint(socket_path.string()));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));    // accepted meanwhile
+    Print("churn, " + std::to_string(idle_sessions) + " idle sessions: ", RunChurn(socket_path));
+    idle.clear();
+
+    std::cout << "connection timeouts, " << sharding::const_values::TIMEOUT_TICK.count() << " ms wheel tick:" << std::endl;
+    for (const size_t connections : WHEEL_CONNECTIONS) {
+        std::cout << connections << " connections" << std::endl;
+        Print("timing wheel", WheelCost(connections));
+        Print("asio timers ", AsioTimerCost(connections));
+    }
+
+    backend_ioc.stop();
+    for (auto &thread : backend_threads) thread.join();
+    sharding::fs::remove_all(dir);
+}
@@ -0,0 +1,59 @@
+// g++ -std=c++20 -O2 -I.. hot_files_bench.cpp ../hot_files.cpp ../io_backend.cpp -pthread
+// Per request cost of a static file: read from disk every time vs a hit in the hot file cache,
+// and how long promoting a batch takes.
+#include "../hot_files.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+namespace {
+
+    const int REQUESTS {20000};
+    const size_t FILE_COUNT {64u};
+    const size_t FILE_SIZE {64u * 1024u};
+
+    template <typename Fn>
+    std::chrono::nanoseconds PerCall (int calls, Fn &&fn) {
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < calls; ++i) fn(i);
+        return (std::chrono::steady_clock::now() - start) / calls;
+    }
+
+}//!namespace
+
+int main () {
+    const auto dir = io::fs::temp_directory_path() / ("hot_files_bench_" + std::to_string(std::random_device{}()));
+    io::fs::create_directories(dir);
+    std::vector<io::fs::path> paths;
+    for (size_t i = 0; i < FILE_COUNT; ++i) {
+        paths.push_back(dir / ("file" + std::to_string(i) + ".js"));
+        std::ofstream(paths.back()) << std::string(FILE_SIZE, static_cast<char>('a' + i % 26));
+    }
+
+    io::PreadFileReader pread;
+    const auto from_disk = PerCall(REQUESTS, [&](int i) {
+        auto content = pread.ReadFiles({paths[i % FILE_COUNT]});
+        if (not content.front()) std::abort();
+    });
+
+    io::HotFiles hot_files(std::make_unique<io::PreadFileReader>());
+    const auto promote_start = std::chrono::steady_clock::now();
+    for (size_t hit = 0; hit < io::const_values::HOT_FILE_HITS; ++hit) {
+        for (const auto &path : paths) hot_files.Touch(path);
+    }
+    hot_files.WaitLoaded();
+    const auto promote = std::chrono::steady_clock::now() - promote_start;
+
+    const auto from_memory = PerCall(REQUESTS, [&](int i) {
+        if (not hot_files.Find(paths[i % FILE_COUNT])) std::abort();
+    });
+
+    std::cout << FILE_COUNT << " files of " << FILE_SIZE / 1024 << " KiB\n"
+              << "pread per request:    " << from_disk.count() << " ns\n"
+              << "HotFiles hit:         " << from_memory.count() << " ns\n"
+              << "promotion:            "
+              << std::chrono::duration_cast<std::chrono::microseconds>(promote).count() << " us" << std::endl;
+    io::fs::remove_all(dir);
+}
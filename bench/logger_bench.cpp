@@ -0,0 +1,64 @@
+// g++ -std=c++20 -O2 -I.. logger_bench.cpp ../logger.cpp -pthread
+// Cost of a Log() call on the producing thread; formatting and writing happen on the writer.
+#include "../logger.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std::string_view_literals;
+
+namespace {
+
+    // below the ring capacity, so nothing is dropped and only the hot path is measured
+    const int CALLS_PER_ROUND {1000};
+    const int ROUNDS {200};
+
+    std::chrono::nanoseconds LogCall (int threads) {
+        std::vector<std::thread> producers;
+        std::vector<std::chrono::nanoseconds> spent(threads);
+        for (int t = 0; t < threads; ++t) {
+            producers.emplace_back([&spent, t] {
+                for (int round = 0; round < ROUNDS; ++round) {
+                    const auto start = std::chrono::steady_clock::now();
+                    for (int i = 0; i < CALLS_PER_ROUND; ++i) {
+                        logging::Log(logging::Level::Info, "bench"sv,
+                                     logging::Kv("round"sv, round),
+                                     logging::Kv("i"sv, i),
+                                     logging::Kv("route"sv, "/api/v1/maps"sv));
+                    }
+                    spent[t] += std::chrono::steady_clock::now() - start;
+                    logging::Logger::Instance().Flush();
+                }
+            });
+        }
+        std::chrono::nanoseconds total {0};
+        for (int t = 0; t < threads; ++t) {
+            producers[t].join();
+            total += spent[t];
+        }
+        return total / (threads * ROUNDS * CALLS_PER_ROUND);
+    }
+
+}//!namespace
+
+int main () {
+    std::FILE *sink = std::fopen("/dev/null", "w");
+    auto &logger = logging::Logger::Instance();
+    logger.SetOutput(sink);
+    for (const int threads : {1, 4}) {
+        std::cout << threads << " threads: " << LogCall(threads).count() << " ns per Log()" << std::endl;
+    }
+    logging::Log(logging::Level::Debug, "filtered"sv);
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < CALLS_PER_ROUND; ++i) logging::Log(logging::Level::Debug, "filtered"sv, logging::Kv("i"sv, i));
+    std::cout << "filtered out: "
+              << std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / CALLS_PER_ROUND
+              << " ns per Log()" << std::endl;
+    std::cout << "dropped: " << logger.DroppedCount() << std::endl;
+    logger.Flush();
+    logger.SetOutput(stderr);
+    std::fclose(sink);
+}
@@ -0,0 +1,224 @@
+// g++ -std=c++20 -O2 -DBOOST_BEAST_USE_STD_STRING_VIEW -I.. shard_router_bench.cpp ../shard_router.cpp ../slab_pool.cpp ../timeout_service.cpp ../timing_wheel.cpp -pthread
+// Front and backends as separate processes: backends are forked, each serves its maps over a Unix socket.
+// Aggregate throughput through one front as the backend count grows, then one of the backends is
+// killed halfway through a run: its maps get 503 right away, the maps of the others keep being served.
+#include "../shard_router.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <thread>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+    namespace net = boost::asio;
+    namespace http = boost::beast::http;
+    using Clock = std::chrono::steady_clock;
+
+    const std::array<size_t, 3> BACKEND_COUNTS {1u, 2u, 4u};
+    const size_t KILLED_OF {4u};                        // backends running when one is killed
+    const int REQUESTS {40000};
+    const int IN_FLIGHT {64};
+    const int FRONT_THREADS {2};
+    const std::chrono::microseconds BACKEND_WORK {20};  // per request, spent on the backend's cpu
+
+    // Answers after BACKEND_WORK of computation, as a map request would
+    struct WorkHandler {
+        template <typename Request, typename Send>
+        void operator() (Request &&request, Send &&send) const {
+            const auto until = Clock::now() + BACKEND_WORK;
+            while (Clock::now() < until) {}
+            types::response::Str response;
+            response.result(http::status::ok);
+            response.body() = R"({"id":")" + std::string(request.target()) + R"("})";
+            response.keep_alive(request.keep_alive());
+            response.prepare_payload();
+            send(types::HttpResponse {std::move(response)});
+        }
+    };
+
+    [[noreturn]] void RunBackend (const sharding::fs::path &socket_path) {
+        net::io_context ioc;
+        WorkHandler handler;
+        std::make_shared<sharding::BackendListener<WorkHandler>>(ioc, socket_path, handler)->Run();
+        ioc.run();
+        std::_Exit(0);
+    }
+
+    // Forked before the front starts any thread, killed and reaped on destruction
+    class Backends final {
+    public:
+        Backends (const sharding::fs::path &dir, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                sockets_.push_back(dir / ("backend" + std::to_string(i) + ".sock"));
+                sharding::fs::remove(sockets_.back());
+                const pid_t pid = ::fork();
+                if (pid < 0) std::abort();
+                if (pid == 0) RunBackend(sockets_.back());
+                pids_.push_back(pid);
+            }
+            net::io_context ioc;
+            for (const auto &socket_path : sockets_) {
+                for (boost::beast::error_code ec {net::error::not_found}; ec;) {
+                    sharding::local::socket probe(ioc);
+                    probe.connect(sharding::local::endpoint(socket_path.string()), ec);
+                    if (ec) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+        }
+        Backends (const Backends&) = delete;
+        Backends& operator= (const Backends&) = delete;
+        ~Backends () {
+            for (const pid_t pid : pids_) {
+                ::kill(pid, SIGKILL);
+                ::waitpid(pid, nullptr, 0);
+            }
+        }
+
+        void Kill (size_t backend) const { ::kill(pids_[backend], SIGKILL); }
+        const std::vector<sharding::fs::path>& Sockets () const { return sockets_; }
+
+    private:
+        std::vector<sharding::fs::path> sockets_;
+        std::vector<pid_t> pids_;
+    };
+
+    // Requests of one half of a run, per backend
+    struct Half {
+        Clock::duration elapsed {};
+        std::vector<int> ok;
+        std::vector<int> unavailable;
+        Clock::duration slowest_unavailable {};
+
+        double PerSecond () const {
+            int requests = 0;
+            for (size_t i = 0; i < ok.size(); ++i) requests += ok[i] + unavailable[i];
+            return requests / std::chrono::duration<double>(elapsed).count();
+        }
+    };
+
+    struct Run {
+        Half first, second;
+    };
+
+    // Keeps IN_FLIGHT requests going until REQUESTS completed; map i belongs to backend i, targets differ
+    // so nothing coalesces. at_half runs right before the first request of the second half starts
+    Run Load (sharding::Router &router, size_t backend_count, const std::function<void ()> &at_half) {
+        Run run;
+        for (Half *half : {&run.first, &run.second}) {
+            half->ok.assign(backend_count, 0);
+            half->unavailable.assign(backend_count, 0);
+        }
+        std::mutex mutex;
+        std::condition_variable done_cv;
+        int completed = 0;
+        Clock::time_point half_start;
+        std::atomic<int> started {0};
+        std::function<void ()> next = [&] {
+            const int n = started++;
+            if (n >= REQUESTS) return;
+            if (n == REQUESTS / 2) {
+                at_half();
+                std::lock_guard lock(mutex);
+                half_start = Clock::now();
+            }
+            const size_t backend = static_cast<size_t>(n) % backend_count;
+            const auto request_start = Clock::now();
+            router.Forward(http::verb::get, "/api/v1/maps/map" + std::to_string(backend), "n=" + std::to_string(n),
+                           [&, n, backend, request_start](types::HttpResponse &&response) {
+                const auto *res = response.template TryAs<types::response::Str>();
+                const bool ok = res && res->result() == http::status::ok;
+                bool done = false;
+                {
+                    std::lock_guard lock(mutex);
+                    Half &half = n < REQUESTS / 2 ? run.first : run.second;
+                    if (ok) {
+                        ++half.ok[backend];
+                    }
+                    else {
+                        ++half.unavailable[backend];
+                        half.slowest_unavailable = std::max(half.slowest_unavailable, Clock::now() - request_start);
+                    }
+                    // notified under the lock: Load returns, and destroys done_cv, as soon as it sees the count
+                    done = ++completed == REQUESTS;
+                    if (done) done_cv.notify_one();
+                }
+                if (not done) next();
+            });
+        };
+        const auto start = Clock::now();
+        for (int i = 0; i < IN_FLIGHT; ++i) next();
+        std::unique_lock lock(mutex);
+        done_cv.wait(lock, [&] { return completed == REQUESTS; });
+        run.first.elapsed = half_start - start;
+        run.second.elapsed = Clock::now() - half_start;
+        return run;
+    }
+
+    // Fresh backends and a fresh front for every run; killed is the backend killed halfway, if any
+    Run Measure (const sharding::fs::path &dir, size_t backend_count, std::optional<size_t> killed) {
+        Backends backends(dir, backend_count);
+        std::unordered_map<std::string, size_t> assignment;
+        for (size_t i = 0; i < backend_count; ++i) assignment.emplace("map" + std::to_string(i), i);
+
+        net::io_context front_ioc;
+        auto work = net::make_work_guard(front_ioc);
+        std::vector<std::thread> front_threads;
+        for (int i = 0; i < FRONT_THREADS; ++i) front_threads.emplace_back([&] { front_ioc.run(); });
+        auto router = std::make_shared<sharding::Router>(front_ioc, backends.Sockets(),
+                                                         sharding::ShardMap(backend_count, std::move(assignment)));
+        const auto run = Load(*router, backend_count, [&] {
+            if (killed) backends.Kill(*killed);
+        });
+        work.reset();
+        front_ioc.stop();
+        for (auto &thread : front_threads) thread.join();
+        return run;
+    }
+
+    std::string PerBackend (const std::vector<int> &counts) {
+        std::string out;
+        for (const int count : counts) out += (out.empty() ? "" : "/") + std::to_string(count);
+        return out;
+    }
+
+}//!namespace
+
+int main () {
+    const auto dir = sharding::fs::temp_directory_path() / ("shard_bench_" + std::to_string(std::random_device{}()));
+    sharding::fs::create_directories(dir);
+
+    std::cout << FRONT_THREADS << " front threads, " << IN_FLIGHT << " requests in flight, "
+              << BACKEND_WORK.count() << " us of work per request on a backend, "
+              << std::thread::hardware_concurrency() << " cores\n"
+              << "backends  requests/s" << std::endl;
+    for (const size_t backend_count : BACKEND_COUNTS) {
+        const auto run = Measure(dir, backend_count, std::nullopt);
+        Half whole = run.first;
+        whole.elapsed += run.second.elapsed;
+        for (size_t i = 0; i < backend_count; ++i) {
+            whole.ok[i] += run.second.ok[i];
+            whole.unavailable[i] += run.second.unavailable[i];
+        }
+        std::cout << "  " << backend_count << "       " << static_cast<long long>(whole.PerSecond()) << std::endl;
+    }
+
+    const auto run = Measure(dir, KILLED_OF, 0u);
+    const auto us = [](Clock::duration d) { return std::chrono::duration_cast<std::chrono::microseconds>(d).count(); };
+    std::cout << "backend 0 of " << KILLED_OF << " killed halfway, per backend ok and 503:\n"
+              << "  before: " << static_cast<long long>(run.first.PerSecond()) << " requests/s, ok "
+              << PerBackend(run.first.ok) << ", 503 " << PerBackend(run.first.unavailable) << "\n"
+              << "  after:  " << static_cast<long long>(run.second.PerSecond()) << " requests/s, ok "
+              << PerBackend(run.second.ok) << ", 503 " << PerBackend(run.second.unavailable)
+              << ", slowest 503 " << us(run.second.slowest_unavailable) << " us" << std::endl;
+    sharding::fs::remove_all(dir);
+}
@@ -0,0 +1,86 @@
+// g++ -std=c++20 -O2 -I.. slab_pool_bench.cpp ../slab_pool.cpp -pthread
+// Cost of an allocate/free pair through the slabs against the global heap, for single blocks
+// and for a session worth of blocks (request, header fields, buffers) freed together.
+#include "../slab_pool.h"
+
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    const int PAIRS {2000000};
+    const std::array<size_t, 4> SIZES {64u, 512u, 4096u, 32u * 1024u};
+    const std::array<size_t, 6> SESSION {512u, 128u, 256u, 4096u, 64u, 8192u};
+    const int THREADS {4};
+
+    struct Pool {
+        static void *Allocate (size_t size) { return memory::Allocate(size); }
+        static void Deallocate (void *p, size_t size) { memory::Deallocate(p, size); }
+    };
+
+    struct Heap {
+        static void *Allocate (size_t size) { return ::operator new(size); }
+        static void Deallocate (void *p, size_t size) { ::operator delete(p, size); }
+    };
+
+    // written through, so allocations can't be elided
+    void Touch (void *p) {
+        *static_cast<volatile char*>(p) = 1;
+    }
+
+    template <typename Allocator>
+    std::chrono::nanoseconds SinglePair (size_t size) {
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < PAIRS; ++i) {
+            void *p = Allocator::Allocate(size);
+            Touch(p);
+            Allocator::Deallocate(p, size);
+        }
+        return (std::chrono::steady_clock::now() - start) / PAIRS;
+    }
+
+    // per pair, every thread allocating a session's blocks and freeing them together
+    template <typename Allocator>
+    std::chrono::nanoseconds Sessions (int threads) {
+        const int sessions = PAIRS / static_cast<int>(SESSION.size());
+        std::vector<std::thread> workers;
+        std::vector<std::chrono::nanoseconds> spent(threads);
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&spent, t, sessions] {
+                std::array<void*, SESSION.size()> blocks {};
+                const auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < sessions; ++i) {
+                    for (size_t b = 0; b < SESSION.size(); ++b) {
+                        blocks[b] = Allocator::Allocate(SESSION[b]);
+                        Touch(blocks[b]);
+                    }
+                    for (size_t b = 0; b < SESSION.size(); ++b) Allocator::Deallocate(blocks[b], SESSION[b]);
+                }
+                spent[t] = (std::chrono::steady_clock::now() - start) / (sessions * static_cast<int>(SESSION.size()));
+            });
+        }
+        std::chrono::nanoseconds total {0};
+        for (int t = 0; t < threads; ++t) {
+            workers[t].join();
+            total += spent[t];
+        }
+        return total / threads;
+    }
+
+}//!namespace
+
+int main () {
+    std::cout << "allocate/free pair, ns      slabs   heap\n";
+    for (const size_t size : SIZES) {
+        std::cout << "  " << size << " B:\t\t\t" << SinglePair<Pool>(size).count()
+                  << "\t" << SinglePair<Heap>(size).count() << "\n";
+    }
+    std::cout << "  session, 1 thread:\t\t" << Sessions<Pool>(1).count()
+              << "\t" << Sessions<Heap>(1).count() << "\n"
+              << "  session, " << THREADS << " threads:\t\t" << Sessions<Pool>(THREADS).count()
+              << "\t" << Sessions<Heap>(THREADS).count() << std::endl;
+}
@@ -0,0 +1,127 @@
+// g++ -std=c++20 -O2 -I.. snapshot_bench.cpp ../persistence.cpp -pthread
+// Request latency (a mutation or a read of the state) with snapshots off and with a snapshot
+// being written all the time, next to what one copy of the state costs, the stall a request
+// would take if it had to clone the state after a snapshot.
+#include "../persistence.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace persistence;
+
+namespace {
+
+    const std::chrono::seconds RUN_TIME {3};
+    const int REQUEST_THREADS {4};
+    const size_t PLAYERS {200000u};
+    const std::chrono::milliseconds BUSY_SNAPSHOT_PERIOD {1};
+    const std::chrono::milliseconds NO_SNAPSHOTS {std::chrono::hours(1)};
+
+    // player id -> position, every record moves one player
+    struct Positions {
+        std::unordered_map<std::uint32_t, std::string> players;
+
+        Positions () {
+            for (std::uint32_t id = 0; id < PLAYERS; ++id) players.emplace(id, "0.0 0.0");
+        }
+
+        void Apply (const Record &record) {
+            const auto id = static_cast<std::uint32_t>(std::stoul(record.payload.substr(0, record.payload.find(' '))));
+            players[id] = record.payload.substr(record.payload.find(' ') + 1);
+        }
+        std::string Serialize () const {
+            std::string out;
+            for (const auto &[id, position] : players) {
+                out += std::to_string(id);
+                out += ' ';
+                out += position;
+                out += '\n';
+            }
+            return out;
+        }
+        static Positions Deserialize (std::string_view data) {
+            Positions positions;
+            while (not data.empty()) {
+                const auto line = data.substr(0, data.find('\n'));
+                const auto space = line.find(' ');
+                positions.players[static_cast<std::uint32_t>(std::stoul(std::string(line.substr(0, space))))] =
+                        std::string(line.substr(space + 1));
+                data.remove_prefix(line.size() + 1);
+            }
+            return positions;
+        }
+    };
+
+    struct Latency {
+        std::chrono::nanoseconds p50, p99, p999, max;
+        size_t requests;
+    };
+
+    Latency Requests (const fs::path &dir, std::chrono::milliseconds snapshot_period) {
+        fs::remove_all(dir);
+        Persister<Positions> persister(dir, snapshot_period);
+        std::atomic<bool> stop {false};
+        std::vector<std::vector<std::chrono::nanoseconds>> samples(REQUEST_THREADS);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < REQUEST_THREADS; ++t) {
+            threads.emplace_back([&, t] {
+                std::mt19937 random(t);
+                std::uniform_int_distribution<std::uint32_t> player(0, PLAYERS - 1);
+                for (std::uint64_t i = 0; not stop; ++i) {
+                    const auto id = player(random);
+                    const auto start = std::chrono::steady_clock::now();
+                    if (i % 4 == 0) {
+                        persister.Read([id](const Positions &positions) { return positions.players.at(id).size(); });
+                    }
+                    else {
+                        persister.Mutate(0, std::to_string(id) + ' ' + std::to_string(i) + ".5 1.5");
+                    }
+                    samples[t].push_back(std::chrono::steady_clock::now() - start);
+                }
+            });
+        }
+        std::this_thread::sleep_for(RUN_TIME);
+        stop = true;
+        for (auto &thread : threads) thread.join();
+
+        std::vector<std::chrono::nanoseconds> all;
+        for (const auto &thread_samples : samples) all.insert(all.end(), thread_samples.begin(), thread_samples.end());
+        std::sort(all.begin(), all.end());
+        const auto at = [&all](double q) { return all[static_cast<size_t>(q * static_cast<double>(all.size() - 1))]; };
+        return {at(0.5), at(0.99), at(0.999), all.back(), all.size()};
+    }
+
+    void Print (std::string_view name, const Latency &latency) {
+        const auto us = [](std::chrono::nanoseconds ns) {
+            return std::chrono::duration_cast<std::chrono::microseconds>(ns).count();
+        };
+        std::cout << name << ": " << latency.requests << " requests, p50 " << us(latency.p50)
+                  << " us, p99 " << us(latency.p99) << " us, p99.9 " << us(latency.p999)
+                  << " us, max " << us(latency.max) << " us" << std::endl;
+    }
+
+}//!namespace
+
+int main (int argc, char *argv[]) {
+    const fs::path dir = argc > 1
+            ? fs::path(argv[1])
+            : fs::temp_directory_path() / ("snapshot_bench_" + std::to_string(std::random_device{}()));
+
+    const Positions state;
+    const auto copy_start = std::chrono::steady_clock::now();
+    const Positions copy(state);
+    const auto copy_time = std::chrono::steady_clock::now() - copy_start;
+    std::cout << PLAYERS << " players, one copy of the state: "
+              << std::chrono::duration_cast<std::chrono::microseconds>(copy_time).count() << " us" << std::endl;
+
+    Print("no snapshots          ", Requests(dir, NO_SNAPSHOTS));
+    Print("snapshots back to back", Requests(dir, BUSY_SNAPSHOT_PERIOD));
+    fs::remove_all(dir);
+}
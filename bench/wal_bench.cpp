@@ -0,0 +1,58 @@
+// g++ -std=c++20 -O2 -I.. wal_bench.cpp ../persistence.cpp -pthread
+// Durable mutations per second: every writer waits for its own record to be on disk,
+// concurrent writers share fdatasync calls through the group commit.
+#include "../persistence.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace persistence;
+
+namespace {
+
+    const std::chrono::seconds RUN_TIME {3};
+    const size_t PAYLOAD_SIZE {64};
+
+    double DurableAppendsPerSecond (const fs::path &dir, int writers) {
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+        WriteAheadLog wal(dir, 1);
+        std::atomic<bool> stop {false};
+        std::atomic<std::uint64_t> total {0};
+        const std::string payload(PAYLOAD_SIZE, 'p');
+
+        std::vector<std::thread> threads;
+        for (int w = 0; w < writers; ++w) {
+            threads.emplace_back([&] {
+                std::uint64_t done = 0;
+                while (not stop) {
+                    wal.WaitDurable(wal.Append(0, payload));
+                    ++done;
+                }
+                total += done;
+            });
+        }
+        std::this_thread::sleep_for(RUN_TIME);
+        stop = true;
+        for (auto &thread : threads) thread.join();
+        return static_cast<double>(total) / RUN_TIME.count();
+    }
+
+}//!namespace
+
+int main (int argc, char *argv[]) {
+    // run it on the file system the server keeps its data on
+    const fs::path dir = argc > 1
+            ? fs::path(argv[1])
+            : fs::temp_directory_path() / ("wal_bench_" + std::to_string(std::random_device{}()));
+    for (const int writers : {1, 4, 16, 64}) {
+        std::cout << writers << " writers: " << static_cast<std::uint64_t>(DurableAppendsPerSecond(dir, writers))
+                  << " durable appends/s" << std::endl;
+    }
+    fs::remove_all(dir);
+}
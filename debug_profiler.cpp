@@ -0,0 +1,441 @@
+#include "debug_profiler.h"
+
+#include <cstdlib>
+
+#ifdef GAME_SERVER_DEBUG_PROFILER
+#include "logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <sys/time.h>
+#endif
+
+namespace debug {
+
+    bool IsAdmin (std::string_view token) {
+        const char *env = std::getenv(const_values::ADMIN_TOKEN_ENV);
+        if (not env || *env == '\0') return false;
+        // time depends on the length of the expected token only, not on where the first mismatch is
+        const std::string_view expected(env);
+        size_t diff = token.size() ^ expected.size();
+        for (size_t i = 0; i < expected.size(); ++i) {
+            const char got = i < token.size() ? token[i] : '\0';
+            diff |= static_cast<unsigned char>(got ^ expected[i]);
+        }
+        return diff == 0;
+    }
+
+#ifndef GAME_SERVER_DEBUG_PROFILER
+
+    bool IsCompiledIn () {
+        return false;
+    }
+
+    StartResult StartCpuProfile (std::chrono::seconds, int) {
+        return StartResult::Unavailable;
+    }
+
+    ProfileState CollectCpuProfile (std::string&) {
+        return ProfileState::None;
+    }
+
+    StartResult StartAllocationProfile (std::chrono::seconds) {
+        return StartResult::Unavailable;
+    }
+
+    ProfileState CollectAllocationProfile (std::string&) {
+        return ProfileState::None;
+    }
+
+#else
+
+    namespace {
+
+        using namespace std::chrono_literals;
+        using namespace std::string_view_literals;
+
+        // lets signal handlers and allocations running on other threads finish before results are read
+        const auto SETTLE_TIME = 10ms;
+        // OnSigprof itself and the signal trampoline
+        const size_t SIGNAL_FRAMES {2u};
+
+        // One profile of a kind at a time, run on its own thread; the result is kept until the next start
+        class ProfileRun final {
+        public:
+            ~ProfileRun () {
+                {
+                    std::lock_guard lock(mutex_);
+                    stop_ = true;
+                }
+                stop_cv_.notify_all();
+                if (thread_.joinable()) thread_.join();
+            }
+
+            // setup runs under the lock and returns false on failure, profile runs on the profiling thread
+            template <typename Setup, typename Profile>
+            StartResult Start (Setup &&setup, Profile &&profile) {
+                std::lock_guard lock(mutex_);
+                if (state_ == ProfileState::Running) return StartResult::Busy;
+                if (thread_.joinable()) thread_.join();     // finished, state_ is Ready
+                if (not setup()) return StartResult::Failed;
+                state_ = ProfileState::Running;
+                result_.clear();
+                thread_ = std::thread([this, profile = std::forward<Profile>(profile)] () mutable {
+                    std::string result = profile();
+                    std::lock_guard lock(mutex_);
+                    result_ = std::move(result);
+                    state_ = ProfileState::Ready;
+                });
+                return StartResult::Started;
+            }
+
+            ProfileState Collect (std::string &result) const {
+                std::lock_guard lock(mutex_);
+                if (state_ == ProfileState::Ready) result = result_;
+                return state_;
+            }
+
+            // Called by the profiling thread, cut short on shutdown
+            void Sleep (std::chrono::seconds duration) {
+                std::unique_lock lock(mutex_);
+                stop_cv_.wait_for(lock, duration, [this] { return stop_; });
+            }
+
+        private:
+            mutable std::mutex mutex_;
+            std::condition_variable stop_cv_;
+            ProfileState state_ {ProfileState::None};
+            bool stop_ {false};
+            std::string result_;
+            std::thread thread_;
+        };
+
+        void LogSetupFailure (std::string_view what) {
+            logging::Log(logging::Level::Error, "profiler setup failed"sv,
+                         logging::Kv("call"sv, what),
+                         logging::Kv("error"sv, std::string(std::strerror(errno))));
+        }
+
+        std::chrono::seconds ClampDuration (std::chrono::seconds duration) {
+            return std::clamp(duration, std::chrono::seconds{1}, const_values::MAX_PROFILE_DURATION);
+        }
+
+        // ---- CPU ----
+
+        struct StackSample {
+            int depth;
+            void *pcs[const_values::MAX_STACK_DEPTH];
+        };
+
+        ProfileRun cpu_profile_run;
+        StackSample *stack_samples {nullptr};
+        size_t stack_samples_capacity {0};
+        std::atomic<size_t> stack_samples_count {0};
+
+        void OnSigprof (int, siginfo_t*, void*) {
+            const int saved_errno = errno;
+            const size_t index = stack_samples_count.fetch_add(1, std::memory_order_relaxed);
+            if (index < stack_samples_capacity) {
+                StackSample &sample = stack_samples[index];
+                sample.depth = ::backtrace(sample.pcs, static_cast<int>(const_values::MAX_STACK_DEPTH));
+            }
+            errno = saved_errno;
+        }
+
+        std::string Symbolize (void *pc) {
+            Dl_info info {};
+            if (::dladdr(pc, &info) && info.dli_sname) {
+                int status = 0;
+                char *demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+                std::string name = status == 0 && demangled ? demangled : info.dli_sname;
+                std::free(demangled);
+                std::replace(name.begin(), name.end(), ';', ':');   // ';' separates frames
+                return name;
+            }
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%p", pc);
+            return buffer;
+        }
+
+        std::string Collapse (const StackSample *samples, size_t count) {
+            std::unordered_map<void*, std::string> symbols;
+            std::map<std::string, size_t> stacks;
+            for (size_t i = 0; i < count; ++i) {
+                const auto &sample = samples[i];
+                if (sample.depth <= static_cast<int>(SIGNAL_FRAMES)) continue;
+                std::string stack;
+                for (int frame = sample.depth - 1; frame >= static_cast<int>(SIGNAL_FRAMES); --frame) {
+                    void *pc = sample.pcs[frame];
+                    auto found = symbols.find(pc);
+                    if (found == symbols.end()) found = symbols.emplace(pc, Symbolize(pc)).first;
+                    if (not stack.empty()) stack += ';';
+                    stack += found->second;
+                }
+                ++stacks[stack];
+            }
+            std::string result;
+            for (const auto &[stack, hits] : stacks) {
+                result += stack;
+                result += ' ';
+                result += std::to_string(hits);
+                result += '\n';
+            }
+            return result;
+        }
+
+        // ---- allocations ----
+
+        struct RouteStats {
+            std::atomic<std::uint64_t> hash {0};
+            std::atomic<bool> ready {false};
+            char name[const_values::ALLOC_ROUTE_NAME_SIZE] {};
+            std::atomic<std::uint64_t> samples {0};
+            std::atomic<std::uint64_t> sampled_bytes {0};
+        };
+
+        ProfileRun alloc_profile_run;
+        std::atomic<bool> alloc_tracking {false};
+        RouteStats route_stats[const_values::ALLOC_ROUTES_CAPACITY];
+        std::atomic<std::uint64_t> untracked_samples {0};   // route table overflow
+
+        thread_local std::string_view current_route;
+        thread_local std::int64_t bytes_until_sample {static_cast<std::int64_t>(const_values::ALLOC_SAMPLE_BYTES)};
+
+        std::uint64_t HashRoute (std::string_view route) {
+            std::uint64_t hash = 14695981039346656037ull;
+            for (const char c : route) {
+                hash ^= static_cast<unsigned char>(c);
+                hash *= 1099511628211ull;
+            }
+            return hash | 1u;   // 0 marks a free slot
+        }
+
+        // Runs inside operator new: must not allocate
+        void RecordAllocation (size_t size) {
+            const std::string_view route = current_route.empty() ? std::string_view("<none>") : current_route;
+            const std::uint64_t hash = HashRoute(route);
+            for (size_t probe = 0; probe < const_values::ALLOC_ROUTES_CAPACITY; ++probe) {
+                RouteStats &stats = route_stats[(hash + probe) % const_values::ALLOC_ROUTES_CAPACITY];
+                std::uint64_t slot_hash = stats.hash.load(std::memory_order_acquire);
+                if (slot_hash == 0 && stats.hash.compare_exchange_strong(slot_hash, hash)) {
+                    const size_t length = std::min(route.size(), const_values::ALLOC_ROUTE_NAME_SIZE - 1);
+                    std::memcpy(stats.name, route.data(), length);
+                    stats.name[length] = '\0';
+                    stats.ready.store(true, std::memory_order_release);
+                    slot_hash = hash;
+                }
+                if (slot_hash == hash) {
+                    stats.samples.fetch_add(1, std::memory_order_relaxed);
+                    stats.sampled_bytes.fetch_add(size, std::memory_order_relaxed);
+                    return;
+                }
+            }
+            untracked_samples.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void ResetRouteStats () {
+            for (auto &stats : route_stats) {
+                stats.ready.store(false);
+                stats.samples.store(0);
+                stats.sampled_bytes.store(0);
+                stats.hash.store(0);
+            }
+            untracked_samples.store(0);
+        }
+
+        void *Allocate (size_t size) noexcept {
+            if (alloc_tracking.load(std::memory_order_relaxed)) {
+                bytes_until_sample -= static_cast<std::int64_t>(size);
+                if (bytes_until_sample < 0) {
+                    bytes_until_sample = static_cast<std::int64_t>(const_values::ALLOC_SAMPLE_BYTES);
+                    RecordAllocation(size);
+                }
+            }
+            return std::malloc(size == 0 ? 1 : size);
+        }
+
+    }//!namespace
+
+    bool IsCompiledIn () {
+        return true;
+    }
+
+    StartResult StartCpuProfile (std::chrono::seconds duration, int frequency) {
+        duration = ClampDuration(duration);
+        frequency = std::clamp(frequency, 1, const_values::MAX_CPU_FREQUENCY);
+
+        // ITIMER_PROF ticks on process CPU time, so every busy core adds its own samples
+        const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+        const size_t capacity = std::min(static_cast<size_t>(frequency) * duration.count() * cores,
+                                         const_values::MAX_CPU_SAMPLES);
+        auto samples = std::shared_ptr<StackSample[]>(new StackSample[capacity]);  // left uninitialized
+        auto previous = std::make_shared<struct sigaction>();
+
+        const auto setup = [&] {
+            stack_samples = samples.get();
+            stack_samples_capacity = capacity;
+            stack_samples_count.store(0);
+
+            void *warm_up[1];
+            ::backtrace(warm_up, 1);    // the first call loads libgcc, not something to do in a signal handler
+
+            struct sigaction action {};
+            action.sa_sigaction = &OnSigprof;
+            action.sa_flags = SA_RESTART | SA_SIGINFO;
+            sigemptyset(&action.sa_mask);
+            if (::sigaction(SIGPROF, &action, previous.get()) != 0) {
+                LogSetupFailure("sigaction"sv);
+                return false;
+            }
+
+            const auto interval = std::chrono::microseconds(std::chrono::seconds{1}) / frequency;
+            itimerval timer {};
+            timer.it_interval.tv_sec = std::chrono::duration_cast<std::chrono::seconds>(interval).count();
+            timer.it_interval.tv_usec = (interval % std::chrono::seconds{1}).count();
+            timer.it_value = timer.it_interval;
+            if (::setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+                LogSetupFailure("setitimer"sv);
+                ::sigaction(SIGPROF, previous.get(), nullptr);
+                return false;
+            }
+            return true;
+        };
+
+        const auto profile = [duration, samples, previous] {
+            cpu_profile_run.Sleep(duration);
+
+            itimerval timer {};
+            ::setitimer(ITIMER_PROF, &timer, nullptr);
+            std::this_thread::sleep_for(SETTLE_TIME);
+            ::sigaction(SIGPROF, previous.get(), nullptr);
+
+            const size_t taken = stack_samples_count.load();
+            const size_t count = std::min(taken, stack_samples_capacity);
+            stack_samples = nullptr;
+            stack_samples_capacity = 0;
+            if (taken > count) {
+                logging::Log(logging::Level::Warning, "cpu profile sample buffer full"sv,
+                             logging::Kv("kept"sv, count),
+                             logging::Kv("lost"sv, taken - count));
+            }
+            return Collapse(samples.get(), count);
+        };
+
+        return cpu_profile_run.Start(setup, profile);
+    }
+
+    ProfileState CollectCpuProfile (std::string &result) {
+        return cpu_profile_run.Collect(result);
+    }
+
+    StartResult StartAllocationProfile (std::chrono::seconds duration) {
+        duration = ClampDuration(duration);
+
+        const auto setup = [] {
+            ResetRouteStats();
+            alloc_tracking.store(true);
+            return true;
+        };
+
+        const auto profile = [duration] {
+            alloc_profile_run.Sleep(duration);
+            alloc_tracking.store(false);
+            std::this_thread::sleep_for(SETTLE_TIME);
+
+            std::string result = "{\"sample_bytes\":" + std::to_string(const_values::ALLOC_SAMPLE_BYTES);
+            result += ",\"untracked_samples\":" + std::to_string(untracked_samples.load());
+            result += ",\"routes\":[";
+            bool first = true;
+            for (const auto &stats : route_stats) {
+                if (not stats.ready.load(std::memory_order_acquire)) continue;
+                const auto samples = stats.samples.load();
+                if (not first) result += ',';
+                first = false;
+                result += "{\"route\":";
+                logging::format::AppendEscaped(result, stats.name);
+                result += ",\"samples\":" + std::to_string(samples);
+                result += ",\"estimated_bytes\":" + std::to_string(samples * const_values::ALLOC_SAMPLE_BYTES);
+                result += ",\"sampled_bytes\":" + std::to_string(stats.sampled_bytes.load());
+                result += '}';
+            }
+            result += "]}";
+            return result;
+        };
+
+        return alloc_profile_run.Start(setup, profile);
+    }
+
+    ProfileState CollectAllocationProfile (std::string &result) {
+        return alloc_profile_run.Collect(result);
+    }
+
+    RouteScope::RouteScope (std::string_view route)
+            : previous_(current_route) {
+        current_route = route;
+    }
+
+    RouteScope::~RouteScope () {
+        current_route = previous_;
+    }
+
+#endif
+
+}//!namespace
+
+#ifdef GAME_SERVER_DEBUG_PROFILER
+
+// Allocation hooks. Only the plain forms are replaced; the default aligned and sized
+// forms end up in these or in their own aligned_alloc/free pair.
+
+void *operator new (size_t size) {
+    if (void *p = debug::Allocate(size); p) return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[] (size_t size) {
+    if (void *p = debug::Allocate(size); p) return p;
+    throw std::bad_alloc();
+}
+
+void *operator new (size_t size, const std::nothrow_t&) noexcept {
+    return debug::Allocate(size);
+}
+
+void *operator new[] (size_t size, const std::nothrow_t&) noexcept {
+    return debug::Allocate(size);
+}
+
+void operator delete (void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[] (void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete (void *p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[] (void *p, size_t) noexcept {
+    std::free(p);
+}
+
+#endif
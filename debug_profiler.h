@@ -0,0 +1,77 @@
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#ifndef GAME_SERVER_DEBUG_PROFILER_H
+#define GAME_SERVER_DEBUG_PROFILER_H
+
+// Built only with -DGAME_SERVER_DEBUG_PROFILER (link with -rdynamic to get symbol names).
+// Without it everything below is a no-op and operator new is left alone.
+// At runtime the admin routes also require GAME_SERVER_ADMIN_TOKEN to be set in the environment.
+// Profiles run on a thread of their own: one request starts a profile, later ones collect it,
+// no request thread waits for the profiling duration.
+
+namespace debug {
+
+    namespace const_values {
+        static const char *const ADMIN_TOKEN_ENV {"GAME_SERVER_ADMIN_TOKEN"};
+        static const std::chrono::seconds MAX_PROFILE_DURATION {60};
+        static const int DEFAULT_CPU_FREQUENCY {99};                 // Hz, off the beat of periodic work
+        static const int MAX_CPU_FREQUENCY {1000};
+        static const size_t MAX_STACK_DEPTH {64u};
+        static const size_t MAX_CPU_SAMPLES {16384u};               // ~8.5 MB of stacks, whatever the core count
+        static const size_t ALLOC_SAMPLE_BYTES {512u * 1024u};       // one sample per this many bytes, on average
+        static const size_t ALLOC_ROUTES_CAPACITY {256u};
+        static const size_t ALLOC_ROUTE_NAME_SIZE {64u};
+    }
+
+    enum class StartResult {
+        Started,
+        Busy,           // a profile of this kind is running
+        Failed,         // timer or signal setup failed, logged
+        Unavailable     // compiled out
+    };
+
+    enum class ProfileState {
+        None,           // never started
+        Running,
+        Ready
+    };
+
+    bool IsCompiledIn ();
+    // Checks token against GAME_SERVER_ADMIN_TOKEN in constant time, false when the variable is unset
+    bool IsAdmin (std::string_view token);
+
+    // Samples every thread on SIGPROF for duration, the result is collapsed stacks ("main;f;g 42\n")
+    StartResult StartCpuProfile (std::chrono::seconds duration, int frequency);
+    // Sets result only when Ready; the result of the last profile stays until the next one starts
+    ProfileState CollectCpuProfile (std::string &result);
+
+    // Samples allocations for duration, the result is per-route JSON
+    StartResult StartAllocationProfile (std::chrono::seconds duration);
+    ProfileState CollectAllocationProfile (std::string &result);
+
+#ifdef GAME_SERVER_DEBUG_PROFILER
+    // Allocations made by the current thread while it is alive are attributed to route
+    class RouteScope final {
+    public:
+        explicit RouteScope (std::string_view route);
+        RouteScope (const RouteScope&) = delete;
+        RouteScope& operator= (const RouteScope&) = delete;
+        ~RouteScope ();
+    private:
+        std::string_view previous_;
+    };
+#else
+    class RouteScope final {
+    public:
+        explicit RouteScope (std::string_view) {}
+    };
+#endif
+
+}//!namespace
+
+#endif //GAME_SERVER_DEBUG_PROFILER_H
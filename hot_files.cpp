@@ -0,0 +1,144 @@
+#include "hot_files.h"
+
+#include <iterator>
+#include <system_error>
+
+namespace io {
+
+    HotFiles::HotFiles (std::unique_ptr<FileReader> reader)
+            : reader_(std::move(reader)) {
+        loader_ = std::thread([this] { LoaderLoop(); });
+    }
+
+    HotFiles::~HotFiles () {
+        {
+            std::lock_guard lock(queue_mutex_);
+            stop_ = true;
+        }
+        queue_cv_.notify_all();
+        if (loader_.joinable()) loader_.join();
+    }
+
+    std::shared_ptr<const std::string> HotFiles::Find (const fs::path &path) {
+        const auto now = SteadyClock::now();
+        {
+            std::shared_lock lock(cache_mutex_);
+            const auto found = cache_.find(path.native());
+            if (found == cache_.end()) return nullptr;
+            if (now - found->second.checked < const_values::HOT_FILE_RECHECK) return found->second.content;
+        }
+
+        std::error_code ec;
+        const auto mtime = fs::last_write_time(path, ec);
+        std::unique_lock lock(cache_mutex_);
+        const auto found = cache_.find(path.native());
+        if (found == cache_.end()) return nullptr;
+        if (ec || mtime != found->second.mtime) {
+            // changed on disk: serve it from disk and let it become hot again
+            cache_.erase(found);
+            return nullptr;
+        }
+        found->second.checked = now;
+        return found->second.content;
+    }
+
+    void HotFiles::Touch (const fs::path &path) {
+        std::vector<fs::path> promoted;
+        {
+            std::lock_guard lock(hits_mutex_);
+            auto candidate = hits_.find(path.native());
+            if (candidate == hits_.end()) {
+                if (hits_.size() >= const_values::HOT_FILE_CANDIDATES_MAX_COUNT) EvictColdCandidates();
+                candidate = hits_.emplace(path.native(), 0u).first;
+            }
+            if (++candidate->second < const_values::HOT_FILE_HITS) return;
+            // everything that is close to hot goes into the same batch
+            for (auto it = hits_.begin(); it != hits_.end();) {
+                if (it->second * 2 >= const_values::HOT_FILE_HITS) {
+                    promoted.emplace_back(it->first);
+                    it = hits_.erase(it);
+                }
+                else {
+                    ++it;
+                }
+            }
+        }
+        {
+            std::shared_lock lock(cache_mutex_);
+            if (cache_.size() >= const_values::HOT_FILES_MAX_COUNT) return;
+        }
+        {
+            std::lock_guard lock(queue_mutex_);
+            queued_.insert(queued_.end(), std::make_move_iterator(promoted.begin()), std::make_move_iterator(promoted.end()));
+        }
+        queue_cv_.notify_one();
+    }
+
+    void HotFiles::EvictColdCandidates () {
+        // the fewest hits go first: a scan of paths seen once doesn't reset the files that keep coming back.
+        // Every entry is below HOT_FILE_HITS, so the floor gets there before the loop runs out
+        const size_t keep = const_values::HOT_FILE_CANDIDATES_MAX_COUNT * 3 / 4;
+        for (size_t floor = 1; hits_.size() > keep; floor *= 2) {
+            std::erase_if(hits_, [floor](const auto &candidate) { return candidate.second <= floor; });
+        }
+    }
+
+    void HotFiles::WaitLoaded () {
+        std::unique_lock lock(queue_mutex_);
+        loaded_cv_.wait(lock, [this] { return (queued_.empty() && not loading_) || stop_; });
+    }
+
+    void HotFiles::LoaderLoop () {
+        std::unique_lock lock(queue_mutex_);
+        while (true) {
+            queue_cv_.wait(lock, [this] { return stop_ || not queued_.empty(); });
+            if (stop_) break;
+            // whatever got promoted meanwhile goes into the same batch
+            auto batch = std::move(queued_);
+            queued_.clear();
+            loading_ = true;
+            lock.unlock();
+            try {
+                Load(std::move(batch));
+            }
+            catch (const std::exception&) {
+                // the files keep being served from disk and may get hot again
+            }
+            lock.lock();
+            loading_ = false;
+            loaded_cv_.notify_all();
+        }
+    }
+
+    void HotFiles::Load (std::vector<fs::path> &&paths) {
+        // big files stay on the file_body path
+        std::erase_if(paths, [](const fs::path &path) {
+            std::error_code ec;
+            const auto size = fs::file_size(path, ec);
+            return ec || size > const_values::HOT_FILE_MAX_SIZE;
+        });
+        if (paths.empty()) return;
+
+        std::vector<fs::file_time_type> mtimes;
+        mtimes.reserve(paths.size());
+        for (const auto &path : paths) {
+            std::error_code ec;
+            mtimes.push_back(fs::last_write_time(path, ec));
+        }
+
+        auto contents = reader_->ReadFiles(paths);
+
+        const auto now = SteadyClock::now();
+        std::unique_lock lock(cache_mutex_);
+        for (size_t i = 0; i < paths.size(); ++i) {
+            if (cache_.size() >= const_values::HOT_FILES_MAX_COUNT) break;
+            if (not contents[i] || contents[i]->size() > const_values::HOT_FILE_MAX_SIZE) continue;
+            cache_[paths[i].native()] = Entry {
+                    std::make_shared<const std::string>(std::move(*contents[i])),
+                    mtimes[i],
+                    now
+            };
+        }
+    }
+
+}//!namespace
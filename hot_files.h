@@ -0,0 +1,79 @@
+#pragma once
+
+#include "io_backend.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifndef GAME_SERVER_HOT_FILES_H
+#define GAME_SERVER_HOT_FILES_H
+
+namespace io {
+
+    namespace const_values {
+        static const size_t HOT_FILE_HITS {8u};                    // misses before a file is cached
+        static const size_t HOT_FILE_MAX_SIZE {1024u * 1024u};
+        static const size_t HOT_FILES_MAX_COUNT {256u};
+        static const size_t HOT_FILE_CANDIDATES_MAX_COUNT {4096u};     // paths counted, the coldest go past it
+        static const std::chrono::seconds HOT_FILE_RECHECK {1};    // how stale a cached file may get
+    }
+
+    // Hot file cache: in-memory copies of frequently requested static files.
+    // Files become hot after HOT_FILE_HITS misses and are loaded in batches through FileReader
+    // on a loader thread of its own, request threads never wait for the reads.
+    class HotFiles final {
+    public:
+        explicit HotFiles (std::unique_ptr<FileReader> reader);
+        HotFiles (const HotFiles&) = delete;
+        HotFiles& operator= (const HotFiles&) = delete;
+        ~HotFiles ();
+
+        // Null when the file is not cached or has changed on disk since
+        std::shared_ptr<const std::string> Find (const fs::path &path);
+        // Counts a miss served from disk, queues the file for loading once it is hot
+        void Touch (const fs::path &path);
+        // Blocks until every queued file is loaded
+        void WaitLoaded ();
+
+    private:
+        using SteadyClock = std::chrono::steady_clock;
+
+        struct Entry {
+            std::shared_ptr<const std::string> content;
+            fs::file_time_type mtime;
+            SteadyClock::time_point checked;
+        };
+
+        std::shared_mutex cache_mutex_;
+        std::unordered_map<std::string, Entry> cache_;
+
+        std::mutex hits_mutex_;
+        std::unordered_map<std::string, size_t> hits_;
+
+        std::unique_ptr<FileReader> reader_;     // used by the loader thread only
+
+        std::mutex queue_mutex_;
+        std::condition_variable queue_cv_;
+        std::condition_variable loaded_cv_;
+        std::vector<fs::path> queued_;
+        bool loading_ {false};
+        bool stop_ {false};
+        std::thread loader_;
+
+        // Called with hits_mutex_ held, frees a quarter of the candidates at least
+        void EvictColdCandidates ();
+        void LoaderLoop ();
+        void Load (std::vector<fs::path> &&paths);
+    };
+
+}//!namespace
+
+#endif //GAME_SERVER_HOT_FILES_H
@@ -5,7 +5,11 @@
 #pragma once
 
 #include "object_holder.h"
+#include "slab_pool.h"
 
+#include <cstdint>
+#include <memory>
+#include <string>
 #include <variant>
 #include <boost/beast/http.hpp>
 
@@ -14,9 +18,47 @@
 
 namespace types {
 
+    // Header fields allocated from per-thread slabs and reused across connections
+    using PooledFields = boost::beast::http::basic_fields<memory::PoolAllocator<char>>;
+
     namespace response {
         namespace http = boost::beast::http;
 
+        using Fields = PooledFields;
+
+        // Immutable body shared between responses (cached files, pre-serialized JSON),
+        // sending it copies nothing
+        struct SharedStrBody {
+            using value_type = std::shared_ptr<const std::string>;
+
+            static std::uint64_t size (const value_type &body) {
+                return body ? body->size() : 0u;
+            }
+
+            class writer {
+            public:
+                using const_buffers_type = boost::asio::const_buffer;
+
+                template <bool isRequest, class Fields>
+                writer (const http::header<isRequest, Fields>&, const value_type &body)
+                        : body_(body)
+                {}
+
+                void init (boost::beast::error_code &ec) {
+                    ec = {};
+                }
+
+                boost::optional<std::pair<const_buffers_type, bool>> get (boost::beast::error_code &ec) {
+                    ec = {};
+                    if (not body_) return boost::none;
+                    return {{const_buffers_type(body_->data(), body_->size()), false}};
+                }
+
+            private:
+                const value_type &body_;
+            };
+        };
+
         using StrBody = http::string_body;
         using FileBody = http::file_body;
         using EmptyBody = http::empty_body;
@@ -24,17 +66,20 @@ namespace types {
         using StrBodyType = http::string_body::value_type;
         using FileBodyType = http::file_body::value_type;
         using EmptyBodyType = http::empty_body::value_type;
+        using SharedStrBodyType = SharedStrBody::value_type;
 
         using None = std::monostate;
-        using Str = http::response<StrBody>;
-        using File = http::response<FileBody>;
-        using Empty = http::response<EmptyBody>;
+        using Str = http::response<StrBody, Fields>;
+        using File = http::response<FileBody, Fields>;
+        using Empty = http::response<EmptyBody, Fields>;
+        using SharedStr = http::response<SharedStrBody, Fields>;
 
         using Type = std::variant<
                 None,
                 Str,
                 File,
-                Empty
+                Empty,
+                SharedStr
         >;
 
     } // namespace response
@@ -0,0 +1,71 @@
+#include "io_backend.h"
+
+#include <cerrno>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace io {
+
+    namespace {
+
+        // Opened file with its size, closed on scope exit
+        struct OpenFile {
+            int fd {-1};
+            size_t size {0};
+
+            explicit OpenFile (const fs::path &path) {
+                fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+                if (fd < 0) return;
+                struct stat st {};
+                if (::fstat(fd, &st) != 0 || not S_ISREG(st.st_mode)) {
+                    ::close(fd);
+                    fd = -1;
+                    return;
+                }
+                size = static_cast<size_t>(st.st_size);
+            }
+            OpenFile (const OpenFile&) = delete;
+            OpenFile& operator= (const OpenFile&) = delete;
+            OpenFile (OpenFile &&other) noexcept
+                    : fd(std::exchange(other.fd, -1))
+                    , size(other.size)
+            {}
+            ~OpenFile () {
+                if (fd >= 0) ::close(fd);
+            }
+
+            bool IsOpen () const { return fd >= 0; }
+        };
+
+    }//!namespace
+
+    std::vector<std::optional<std::string>> PreadFileReader::ReadFiles (const std::vector<fs::path> &paths) {
+        std::vector<std::optional<std::string>> result(paths.size());
+        for (size_t i = 0; i < paths.size(); ++i) {
+            OpenFile file(paths[i]);
+            if (not file.IsOpen()) continue;
+            std::string content(file.size, '\0');
+            size_t offset = 0;
+            bool failed = false;
+            while (offset < content.size()) {
+                const ssize_t got = ::pread(file.fd, content.data() + offset, content.size() - offset,
+                                            static_cast<off_t>(offset));
+                if (got < 0 && errno == EINTR) continue;
+                if (got < 0) {
+                    failed = true;
+                    break;
+                }
+                if (got == 0) break;
+                offset += static_cast<size_t>(got);
+            }
+            if (failed) continue;
+            content.resize(offset);
+            result[i] = std::move(content);
+        }
+        return result;
+    }
+
+}//!namespace
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#ifndef GAME_SERVER_IO_BACKEND_H
+#define GAME_SERVER_IO_BACKEND_H
+
+namespace io {
+
+    namespace fs = std::filesystem;
+
+    // Reads whole files for the hot file cache, a batch at a time
+    class FileReader {
+    public:
+        virtual ~FileReader () = default;
+
+        // nullopt for files that could not be opened or read
+        virtual std::vector<std::optional<std::string>> ReadFiles (const std::vector<fs::path> &paths) = 0;
+    };
+
+    class PreadFileReader final : public FileReader {
+    public:
+        std::vector<std::optional<std::string>> ReadFiles (const std::vector<fs::path> &paths) override;
+    };
+
+}//!namespace
+
+#endif //GAME_SERVER_IO_BACKEND_H
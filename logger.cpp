@@ -0,0 +1,259 @@
+#include "logger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+
+namespace logging {
+
+    namespace {
+
+        std::string_view LevelName (Level level) {
+            switch (level) {
+                case Level::Trace: return "trace";
+                case Level::Debug: return "debug";
+                case Level::Info: return "info";
+                case Level::Warning: return "warning";
+                case Level::Error: return "error";
+                default: return "off";
+            }
+        }
+
+        template <size_t N>
+        void CopyTruncated (std::array<char, N> &dst, std::string_view src) {
+            const size_t size = std::min(src.size(), N - 1);
+            std::memcpy(dst.data(), src.data(), size);
+            dst[size] = '\0';
+        }
+
+        // Owned by each producing thread; lets the writer drop the ring once it is drained
+        struct RingHolder {
+            std::shared_ptr<Ring> ring;
+            ~RingHolder () {
+                if (ring) ring->Orphan();
+            }
+        };
+
+    }//!namespace
+
+    void AccessRecord::SetRoute (std::string_view value) {
+        CopyTruncated(route, value);
+    }
+
+    void AccessRecord::SetMethod (std::string_view value) {
+        CopyTruncated(method, value);
+    }
+
+    namespace format {
+
+        void AppendEscaped (std::string &out, std::string_view value) {
+            static const char HEX[] = "0123456789abcdef";
+            out += '"';
+            for (const char c : value) {
+                switch (c) {
+                    case '"': out += "\\\""; break;
+                    case '\\': out += "\\\\"; break;
+                    case '\n': out += "\\n"; break;
+                    case '\r': out += "\\r"; break;
+                    case '\t': out += "\\t"; break;
+                    default:
+                        if (static_cast<unsigned char>(c) < 0x20) {
+                            out += "\\u00";
+                            out += HEX[(c >> 4) & 0xF];
+                            out += HEX[c & 0xF];
+                        }
+                        else {
+                            out += c;
+                        }
+                }
+            }
+            out += '"';
+        }
+
+        void AppendTimestamp (std::string &out, Clock::time_point timestamp) {
+            const auto since_epoch = timestamp.time_since_epoch();
+            const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
+            const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(since_epoch - seconds);
+            const std::time_t time = seconds.count();
+            std::tm tm {};
+            ::gmtime_r(&time, &tm);
+            char buffer[40];
+            const size_t size = std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &tm);
+            out += '"';
+            out.append(buffer, size);
+            std::snprintf(buffer, sizeof(buffer), ".%06ldZ", static_cast<long>(micros.count()));
+            out += buffer;
+            out += '"';
+        }
+
+        void AppendHeader (std::string &out, Clock::time_point timestamp, Level level, std::string_view message) {
+            out += "{\"timestamp\":";
+            AppendTimestamp(out, timestamp);
+            out += ",\"level\":\"";
+            out += LevelName(level);
+            out += "\",\"message\":";
+            AppendEscaped(out, message);
+        }
+
+        void AppendAccess (std::string &out, const AccessRecord &record) {
+            AppendHeader(out, record.timestamp, Level::Info, "access");
+            AppendField(out, Kv("method", std::string_view(record.method.data())));
+            AppendField(out, Kv("route", std::string_view(record.route.data())));
+            AppendField(out, Kv("status", record.status));
+            AppendField(out, Kv("bytes", record.bytes));
+            AppendField(out, Kv("duration_us",
+                                std::chrono::duration_cast<std::chrono::microseconds>(record.duration).count()));
+            out += "}\n";
+        }
+
+    }//!namespace
+
+    size_t Ring::Drain (std::string &out) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        const size_t drained = tail - head;
+        for (; head != tail; ++head) {
+            Slot &slot = slots_[head & MASK];
+            slot.format(slot.storage, out);
+            slot.destroy(slot.storage);
+            head_.store(head + 1, std::memory_order_release);
+        }
+        return drained;
+    }
+
+    bool Ring::Empty () const {
+        // seq_cst: the writer's last look before sleeping, ordered after its writer_idle_ store
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_seq_cst);
+    }
+
+    Logger &Logger::Instance () {
+        static Logger logger;
+        return logger;
+    }
+
+    Logger::Logger () {
+        writer_ = std::thread([this] { WriterLoop(); });
+    }
+
+    Logger::~Logger () {
+        {
+            std::lock_guard lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        if (writer_.joinable()) writer_.join();
+    }
+
+    Ring &Logger::LocalRing () {
+        thread_local RingHolder holder;
+        if (not holder.ring) holder.ring = RegisterRing();
+        return *holder.ring;
+    }
+
+    std::shared_ptr<Ring> Logger::RegisterRing () {
+        auto ring = std::make_shared<Ring>();
+        std::lock_guard lock(mutex_);
+        rings_.push_back(ring);
+        return ring;
+    }
+
+    void Logger::Flush () {
+        std::unique_lock lock(mutex_);
+        const std::uint64_t ticket = ++flush_requested_;
+        wake_.notify_all();
+        flushed_.wait(lock, [this, ticket] { return flush_done_ >= ticket || stop_; });
+    }
+
+    bool Logger::DrainAll (std::string &buffer) {
+        std::vector<std::shared_ptr<Ring>> rings;
+        {
+            std::lock_guard lock(mutex_);
+            rings = rings_;
+        }
+        size_t drained = 0;
+        std::uint64_t dropped = 0;
+        for (const auto &ring : rings) {
+            drained += ring->Drain(buffer);
+            dropped += ring->TakeDropped();
+        }
+        if (dropped != 0) {
+            dropped_total_.fetch_add(dropped, std::memory_order_relaxed);
+            format::AppendHeader(buffer, Clock::now(), Level::Warning, "log records dropped");
+            format::AppendField(buffer, Kv("dropped", dropped));
+            format::AppendField(buffer, Kv("dropped_total", dropped_total_.load(std::memory_order_relaxed)));
+            buffer += "}\n";
+        }
+        if (not buffer.empty()) {
+            std::FILE *out = out_.load(std::memory_order_acquire);
+            std::fwrite(buffer.data(), 1, buffer.size(), out);
+            std::fflush(out);
+            buffer.clear();
+        }
+        {
+            // rings of finished threads go away once nothing is left in them
+            std::lock_guard lock(mutex_);
+            rings_.erase(std::remove_if(rings_.begin(), rings_.end(), [](const auto &ring) {
+                return ring->IsOrphaned() && ring->Empty();
+            }), rings_.end());
+        }
+        return drained != 0;
+    }
+
+    void Logger::WriterLoop () {
+        std::string buffer;
+        std::unique_lock lock(mutex_);
+        while (true) {
+            const std::uint64_t flush_ticket = flush_requested_;
+            const bool stopping = stop_;
+            lock.unlock();
+
+            // a ring orphaned between Drain and IsOrphaned keeps its records until the next round
+            bool busy = DrainAll(buffer);
+            if (stopping) busy = DrainAll(buffer) || busy;
+
+            lock.lock();
+            flush_done_ = std::max(flush_done_, flush_ticket);
+            flushed_.notify_all();
+            if (stopping) break;
+            if (not busy) {
+                // Store idle, then look at the tails; producers store a tail, then look at idle.
+                // All four are seq_cst, so either the producer sees the writer idle and wakes it up,
+                // or the writer sees the record here and doesn't go to sleep.
+                writer_idle_.store(true, std::memory_order_seq_cst);
+                if (not AnyPending()) {
+                    wake_.wait(lock, [this, flush_ticket] {
+                        return stop_ ||
+                               flush_requested_ != flush_ticket ||
+                               not writer_idle_.load(std::memory_order_relaxed);
+                    });
+                }
+                writer_idle_.store(false, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // mutex_ is held by the caller
+    bool Logger::AnyPending () const {
+        return std::any_of(rings_.begin(), rings_.end(), [](const auto &ring) {
+            return not ring->Empty();
+        });
+    }
+
+    void Logger::WakeWriter () {
+        if (not writer_idle_.exchange(false, std::memory_order_acq_rel)) return;
+        {
+            // the writer checks writer_idle_ under the lock, this makes sure it is already waiting
+            std::lock_guard lock(mutex_);
+        }
+        wake_.notify_one();
+    }
+
+    void LogAccess (const AccessRecord &record) {
+        auto &logger = Logger::Instance();
+        if (not logger.IsEnabled(Level::Info)) return;
+        logger.Push([record] (std::string &out) {
+            format::AppendAccess(out, record);
+        });
+    }
+
+}//!namespace
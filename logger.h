@@ -0,0 +1,233 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#ifndef GAME_SERVER_LOGGER_H
+#define GAME_SERVER_LOGGER_H
+
+namespace logging {
+
+    using Clock = std::chrono::system_clock;
+
+    enum class Level : int {
+        Trace = 0,
+        Debug,
+        Info,
+        Warning,
+        Error,
+        Off
+    };
+
+    namespace const_values {
+        static const size_t RING_CAPACITY {2048u};     // slots per producing thread, power of two
+        static const size_t SLOT_STORAGE_SIZE {256u};   // bytes available for captured arguments
+    }
+
+    // Key/value pair of a structured record.
+    // key must outlive the record (string literal), so must string_view / const char* values
+    template <typename T>
+    struct Field {
+        std::string_view key;
+        T value;
+    };
+
+    // Only refers to the value, Log() copies it once the level check has passed
+    template <typename T>
+    Field<T&&> Kv (std::string_view key, T &&value) {
+        return {key, std::forward<T>(value)};
+    }
+
+    template <typename T>
+    Field<std::remove_cvref_t<T>> Capture (Field<T> &&field) {
+        return {field.key, std::forward<T>(field.value)};
+    }
+
+    struct AccessRecord {
+        static const size_t ROUTE_SIZE {128u};
+
+        Clock::time_point timestamp;
+        std::array<char, ROUTE_SIZE> route {};  // truncated, zero-terminated
+        std::array<char, 8> method {};
+        unsigned status {0};
+        std::uint64_t bytes {0};
+        std::chrono::nanoseconds duration {0};
+
+        void SetRoute (std::string_view value);
+        void SetMethod (std::string_view value);
+    };
+
+    // Formatting helpers, called on the writer thread only
+    namespace format {
+        void AppendEscaped (std::string &out, std::string_view value);
+        void AppendTimestamp (std::string &out, Clock::time_point timestamp);
+        void AppendHeader (std::string &out, Clock::time_point timestamp, Level level, std::string_view message);
+        void AppendAccess (std::string &out, const AccessRecord &record);
+
+        inline void AppendValue (std::string &out, bool value) { out += value ? "true" : "false"; }
+        inline void AppendValue (std::string &out, std::string_view value) { AppendEscaped(out, value); }
+        inline void AppendValue (std::string &out, const std::string &value) { AppendEscaped(out, value); }
+        inline void AppendValue (std::string &out, const char *value) { AppendEscaped(out, value); }
+        inline void AppendValue (std::string &out, const std::filesystem::path &value) { AppendEscaped(out, value.native()); }
+
+        template <typename T>
+        std::enable_if_t<std::is_arithmetic_v<T>> AppendValue (std::string &out, T value) {
+            out += std::to_string(value);
+        }
+
+        template <typename T>
+        void AppendField (std::string &out, const Field<T> &field) {
+            out += ',';
+            AppendEscaped(out, field.key);
+            out += ':';
+            AppendValue(out, field.value);
+        }
+    }//!namespace
+
+    // One slot of a ring: type-erased callable, constructed in place, run and destroyed by the writer
+    struct Slot {
+        using FormatFn = void (*)(void *storage, std::string &out);
+        using DestroyFn = void (*)(void *storage);
+
+        FormatFn format {nullptr};
+        DestroyFn destroy {nullptr};
+        alignas(std::max_align_t) unsigned char storage[const_values::SLOT_STORAGE_SIZE];
+    };
+
+    // Single producer (the owning thread) / single consumer (the writer thread) ring
+    class Ring final {
+    public:
+        // false when the ring is full and the record was dropped
+        template <typename Formatter>
+        bool TryPush (Formatter &&formatter);
+        // Formats everything available into out, returns the number of records drained
+        size_t Drain (std::string &out);
+
+        std::uint64_t TakeDropped () { return dropped_.exchange(0, std::memory_order_relaxed); }
+        void Orphan () { orphaned_.store(true, std::memory_order_release); }
+        bool IsOrphaned () const { return orphaned_.load(std::memory_order_acquire); }
+        bool Empty () const;
+
+    private:
+        static constexpr size_t MASK = const_values::RING_CAPACITY - 1;
+        static_assert((const_values::RING_CAPACITY & MASK) == 0, "ring capacity must be a power of two");
+
+        std::array<Slot, const_values::RING_CAPACITY> slots_;
+        alignas(64) std::atomic<size_t> head_ {0};    // next slot to drain, written by the writer
+        alignas(64) std::atomic<size_t> tail_ {0};    // next slot to fill, written by the producer
+        std::atomic<std::uint64_t> dropped_ {0};
+        std::atomic<bool> orphaned_ {false};
+    };
+
+    class Logger final {
+    public:
+        static Logger &Instance ();
+
+        Logger (const Logger&) = delete;
+        Logger& operator= (const Logger&) = delete;
+        ~Logger ();
+
+        bool IsEnabled (Level level) const {
+            return static_cast<int>(level) >= level_.load(std::memory_order_relaxed);
+        }
+        void SetLevel (Level level) { level_.store(static_cast<int>(level), std::memory_order_relaxed); }
+        // Not owned; stderr by default
+        void SetOutput (std::FILE *out) { out_.store(out, std::memory_order_release); }
+        std::uint64_t DroppedCount () const { return dropped_total_.load(std::memory_order_relaxed); }
+
+        template <typename Formatter>
+        void Push (Formatter &&formatter);
+        // Blocks until everything logged by now is written
+        void Flush ();
+
+    private:
+        Logger ();
+
+        std::atomic<int> level_ {static_cast<int>(Level::Info)};
+        std::atomic<std::FILE*> out_ {stderr};
+        std::atomic<std::uint64_t> dropped_total_ {0};
+
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::condition_variable flushed_;
+        std::vector<std::shared_ptr<Ring>> rings_;
+        std::uint64_t flush_requested_ {0};
+        std::uint64_t flush_done_ {0};
+        bool stop_ {false};
+        // set by the writer before it checks the rings one last time and sleeps, producers check it
+        // after every push; both sides seq_cst, so one of them sees the other (see WriterLoop)
+        std::atomic<bool> writer_idle_ {false};
+        std::thread writer_;
+
+        Ring &LocalRing ();
+        std::shared_ptr<Ring> RegisterRing ();
+        void WriterLoop ();
+        bool DrainAll (std::string &buffer);
+        bool AnyPending () const;
+        void WakeWriter ();
+    };
+
+    template <typename Formatter>
+    bool Ring::TryPush (Formatter &&formatter) {
+        using F = std::decay_t<Formatter>;
+        static_assert(sizeof(F) <= const_values::SLOT_STORAGE_SIZE, "log record captures too much, shrink it");
+        static_assert(alignof(F) <= alignof(std::max_align_t), "over-aligned log record");
+
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t head = head_.load(std::memory_order_acquire);
+        if (tail - head == const_values::RING_CAPACITY) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        Slot &slot = slots_[tail & MASK];
+        new (slot.storage) F(std::forward<Formatter>(formatter));
+        slot.format = [](void *storage, std::string &out) { (*std::launder(static_cast<F*>(storage)))(out); };
+        slot.destroy = [](void *storage) { std::launder(static_cast<F*>(storage))->~F(); };
+        // seq_cst: ordered before the writer_idle_ load in Logger::Push
+        tail_.store(tail + 1, std::memory_order_seq_cst);
+        return true;
+    }
+
+    template <typename Formatter>
+    void Logger::Push (Formatter &&formatter) {
+        LocalRing().TryPush(std::forward<Formatter>(formatter));
+        // On every push, not only into an empty ring: whether the ring looked empty depends on a head
+        // read before the record was stored, the writer may have drained and gone to sleep since
+        if (writer_idle_.load(std::memory_order_seq_cst)) WakeWriter();
+    }
+
+    // Arguments are captured by value, formatting into a JSON line happens on the writer thread
+    template <typename... Fields>
+    void Log (Level level, std::string_view message, Field<Fields> &&...fields) {
+        auto &logger = Logger::Instance();
+        if (not logger.IsEnabled(level)) return;
+        logger.Push([timestamp = Clock::now(),
+                     level,
+                     message,
+                     captured = std::make_tuple(Capture(std::move(fields))...)] (std::string &out) {
+            format::AppendHeader(out, timestamp, level, message);
+            std::apply([&out](const auto &...field) { (format::AppendField(out, field), ...); }, captured);
+            out += "}\n";
+        });
+    }
+
+    void LogAccess (const AccessRecord &record);
+
+}//!namespace
+
+#endif //GAME_SERVER_LOGGER_H
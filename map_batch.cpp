@@ -0,0 +1,46 @@
+#include "map_batch.h"
+
+#include <algorithm>
+
+namespace map_batch {
+
+    std::optional<std::string> Assemble (const FragmentsById &maps,
+                                         const std::vector<std::string_view> &ids,
+                                         const std::vector<std::string_view> &fields) {
+        const auto is_requested = [&fields](const std::string &name) {
+            return fields.empty() || std::find(fields.begin(), fields.end(), name) != fields.end();
+        };
+
+        std::vector<const Fragments*> found_maps;
+        found_maps.reserve(ids.size());
+        size_t body_size = 2u;
+        for (const auto id : ids) {
+            const auto found = maps.find(std::string(id));
+            if (found == maps.end()) return std::nullopt;
+            found_maps.push_back(&found->second);
+            for (const auto &[name, fragment] : found->second) {
+                if (is_requested(name)) body_size += fragment.size() + 1u;
+            }
+            body_size += 3u;
+        }
+
+        std::string body;
+        body.reserve(body_size);
+        body += '[';
+        for (const auto *fragments : found_maps) {
+            if (body.size() > 1u) body += ',';
+            body += '{';
+            bool first = true;
+            for (const auto &[name, fragment] : *fragments) {
+                if (not is_requested(name)) continue;
+                if (not first) body += ',';
+                body += fragment;
+                first = false;
+            }
+            body += '}';
+        }
+        body += ']';
+        return body;
+    }
+
+}//!namespace
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifndef GAME_SERVER_MAP_BATCH_H
+#define GAME_SERVER_MAP_BATCH_H
+
+namespace map_batch {
+
+    // "key":value pieces of one map JSON, serialized once, in the order of the map object
+    using Fragments = std::vector<std::pair<std::string, std::string>>;
+    using FragmentsById = std::unordered_map<std::string, Fragments>;
+
+    // [{...},{...}] of the maps in ids order with only the requested fields (all of them if fields is empty).
+    // nullopt if an id is unknown
+    std::optional<std::string> Assemble (const FragmentsById &maps,
+                                         const std::vector<std::string_view> &ids,
+                                         const std::vector<std::string_view> &fields);
+
+}//!namespace
+
+#endif //GAME_SERVER_MAP_BATCH_H
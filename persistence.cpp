@@ -0,0 +1,316 @@
+#include "persistence.h"
+
+#include <boost/crc.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace persistence {
+
+    namespace {
+
+        const std::uint32_t SNAPSHOT_MAGIC {0x47534E50u}; // "GSNP"
+        const size_t RECORD_HEADER_SIZE {sizeof(std::uint32_t) * 2 + sizeof(Lsn) + sizeof(RecordType)};
+
+        template <typename T>
+        void PutRaw (std::string &out, T value) {
+            char bytes[sizeof(T)];
+            std::memcpy(bytes, &value, sizeof(T));
+            out.append(bytes, sizeof(T));
+        }
+
+        template <typename T>
+        bool GetRaw (std::string_view &in, T &value) {
+            if (in.size() < sizeof(T)) return false;
+            std::memcpy(&value, in.data(), sizeof(T));
+            in.remove_prefix(sizeof(T));
+            return true;
+        }
+
+        std::uint32_t Checksum (Lsn lsn, RecordType type, std::string_view payload) {
+            boost::crc_32_type crc;
+            crc.process_bytes(&lsn, sizeof(lsn));
+            crc.process_bytes(&type, sizeof(type));
+            crc.process_bytes(payload.data(), payload.size());
+            return crc.checksum();
+        }
+
+        [[noreturn]] void ThrowErrno (const std::string &what) {
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+
+        void WriteAll (int fd, std::string_view data, const std::string &what) {
+            while (not data.empty()) {
+                const ssize_t written = ::write(fd, data.data(), data.size());
+                if (written < 0) {
+                    if (errno == EINTR) continue;
+                    ThrowErrno(what);
+                }
+                data.remove_prefix(static_cast<size_t>(written));
+            }
+        }
+
+        void SyncDirectory (const fs::path &dir) {
+            const int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+            if (fd < 0) return;
+            ::fsync(fd);
+            ::close(fd);
+        }
+
+        std::string ReadWholeFile (const fs::path &path) {
+            std::ifstream in(path, std::ios::binary);
+            std::ostringstream content;
+            content << in.rdbuf();
+            return content.str();
+        }
+
+        fs::path SegmentPath (const fs::path &dir, Lsn first_lsn) {
+            std::ostringstream name;
+            name << const_values::WAL_PREFIX << std::setw(20) << std::setfill('0') << first_lsn
+                 << const_values::WAL_SUFFIX;
+            return dir / name.str();
+        }
+
+        // Segments sorted by the first lsn they hold
+        std::vector<std::pair<Lsn, fs::path>> ListSegments (const fs::path &dir) {
+            std::vector<std::pair<Lsn, fs::path>> segments;
+            if (not fs::exists(dir)) return segments;
+            for (const auto &entry : fs::directory_iterator(dir)) {
+                const std::string name = entry.path().filename().string();
+                if (name.size() <= const_values::WAL_PREFIX.size() + const_values::WAL_SUFFIX.size() ||
+                    name.compare(0, const_values::WAL_PREFIX.size(), const_values::WAL_PREFIX) != 0 ||
+                    not name.ends_with(const_values::WAL_SUFFIX))
+                    continue;
+                const auto digits = name.substr(
+                        const_values::WAL_PREFIX.size(),
+                        name.size() - const_values::WAL_PREFIX.size() - const_values::WAL_SUFFIX.size());
+                try {
+                    segments.emplace_back(std::stoull(digits), entry.path());
+                }
+                catch (const std::exception&) {
+                    continue; // foreign file, not ours
+                }
+            }
+            std::sort(segments.begin(), segments.end());
+            return segments;
+        }
+
+    }//!namespace
+
+    WriteAheadLog::WriteAheadLog (fs::path dir, Lsn next_lsn)
+            : dir_(std::move(dir))
+            , next_lsn_(next_lsn)
+            , segment_first_lsn_(next_lsn)
+            , durable_lsn_(next_lsn - 1) {
+        OpenSegment(next_lsn);
+        writer_ = std::thread([this] { WriterLoop(); });
+    }
+
+    WriteAheadLog::~WriteAheadLog () {
+        {
+            std::lock_guard lock(mutex_);
+            stop_ = true;
+        }
+        has_work_.notify_all();
+        if (writer_.joinable()) writer_.join();
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    Lsn WriteAheadLog::Append (RecordType type, std::string_view payload) {
+        std::lock_guard lock(mutex_);
+        if (failure_) std::rethrow_exception(failure_);
+        const Lsn lsn = next_lsn_++;
+        PutRaw(pending_, static_cast<std::uint32_t>(payload.size()));
+        PutRaw(pending_, Checksum(lsn, type, payload));
+        PutRaw(pending_, lsn);
+        PutRaw(pending_, type);
+        pending_.append(payload);
+        has_work_.notify_one();
+        return lsn;
+    }
+
+    void WriteAheadLog::WaitDurable (Lsn lsn) {
+        std::unique_lock lock(mutex_);
+        durable_cv_.wait(lock, [this, lsn] { return durable_lsn_ >= lsn || failure_ || stop_; });
+        if (durable_lsn_ < lsn && failure_) std::rethrow_exception(failure_);
+    }
+
+    Lsn WriteAheadLog::Rotate () {
+        std::lock_guard lock(mutex_);
+        if (failure_) std::rethrow_exception(failure_);
+        if (next_lsn_ == segment_first_lsn_ || rotate_requested_) return next_lsn_;
+        sealed_ = std::move(pending_);
+        pending_.clear();
+        rotate_requested_ = true;
+        segment_first_lsn_ = next_lsn_;
+        has_work_.notify_one();
+        return next_lsn_;
+    }
+
+    void WriteAheadLog::DropSegmentsUpTo (Lsn lsn) const {
+        Lsn current_first_lsn = 0;
+        {
+            std::lock_guard lock(mutex_);
+            current_first_lsn = segment_first_lsn_;
+        }
+        // the writer may not have opened the segment of the last Rotate() yet, so the end of
+        // the newest sealed segment comes from memory rather than from the directory listing
+        const auto segments = ListSegments(dir_);
+        for (size_t i = 0; i < segments.size(); ++i) {
+            if (segments[i].first >= current_first_lsn) break;
+            const Lsn next_first_lsn = i + 1 < segments.size()
+                    ? std::min(segments[i + 1].first, current_first_lsn)
+                    : current_first_lsn;
+            if (next_first_lsn - 1 > lsn) break;
+            std::error_code ec;
+            fs::remove(segments[i].second, ec);
+        }
+    }
+
+    Lsn WriteAheadLog::LastLsn () const {
+        std::lock_guard lock(mutex_);
+        return next_lsn_ - 1;
+    }
+
+    Lsn WriteAheadLog::Replay (const fs::path &dir, Lsn after,
+                               const std::function<void(const Record&)> &on_record) {
+        Lsn last_lsn = after;
+        for (const auto &[first_lsn, path] : ListSegments(dir)) {
+            const std::string content = ReadWholeFile(path);
+            std::string_view in = content;
+            while (in.size() >= RECORD_HEADER_SIZE) {
+                std::uint32_t size = 0;
+                std::uint32_t crc = 0;
+                Record record;
+                GetRaw(in, size);
+                GetRaw(in, crc);
+                GetRaw(in, record.lsn);
+                GetRaw(in, record.type);
+                if (in.size() < size) break;
+                const std::string_view payload = in.substr(0, size);
+                in.remove_prefix(size);
+                if (Checksum(record.lsn, record.type, payload) != crc) break;
+                if (record.lsn <= last_lsn) continue;
+                record.payload = std::string(payload);
+                on_record(record);
+                last_lsn = record.lsn;
+            }
+        }
+        return last_lsn;
+    }
+
+    void WriteAheadLog::WriterLoop () {
+        std::unique_lock lock(mutex_);
+        while (true) {
+            has_work_.wait(lock, [this] { return stop_ || rotate_requested_ || not pending_.empty(); });
+            if (stop_ && pending_.empty() && not rotate_requested_) break;
+
+            std::string sealed = std::move(sealed_);
+            std::string batch = std::move(pending_);
+            sealed_.clear();
+            pending_.clear();
+            const bool rotate = std::exchange(rotate_requested_, false);
+            const Lsn new_segment_first_lsn = segment_first_lsn_;
+            const Lsn batch_last_lsn = next_lsn_ - 1;
+            lock.unlock();
+
+            std::exception_ptr failure;
+            try {
+                if (rotate) {
+                    WriteDurably(sealed);
+                    ::close(fd_);
+                    fd_ = -1;
+                    OpenSegment(new_segment_first_lsn);
+                }
+                WriteDurably(batch);
+            }
+            catch (const std::exception&) {
+                failure = std::current_exception();
+            }
+
+            lock.lock();
+            if (failure) {
+                // what reached the disk is unknown, so waiters of this batch and later ones get the error
+                failure_ = failure;
+                durable_cv_.notify_all();
+                break;
+            }
+            durable_lsn_ = batch_last_lsn;
+            durable_cv_.notify_all();
+        }
+    }
+
+    void WriteAheadLog::OpenSegment (Lsn first_lsn) {
+        const auto path = SegmentPath(dir_, first_lsn);
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ < 0) ThrowErrno("can't open WAL segment " + path.string());
+        SyncDirectory(dir_);
+    }
+
+    void WriteAheadLog::WriteDurably (const std::string &batch) const {
+        if (batch.empty()) return;
+        WriteAll(fd_, batch, "WAL write failed");
+        if (::fdatasync(fd_) != 0) ThrowErrno("WAL fdatasync failed");
+    }
+
+    SnapshotFile::SnapshotFile (fs::path dir)
+            : dir_(std::move(dir))
+    {}
+
+    void SnapshotFile::Write (Lsn lsn, std::string_view data) const {
+        std::string header;
+        PutRaw(header, SNAPSHOT_MAGIC);
+        PutRaw(header, lsn);
+        PutRaw(header, static_cast<std::uint64_t>(data.size()));
+        boost::crc_32_type crc;
+        crc.process_bytes(data.data(), data.size());
+        PutRaw(header, static_cast<std::uint32_t>(crc.checksum()));
+
+        const auto tmp_path = dir_ / const_values::SNAPSHOT_TMP_FILE;
+        const int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) ThrowErrno("can't open snapshot " + tmp_path.string());
+        try {
+            WriteAll(fd, header, "snapshot write failed");
+            WriteAll(fd, data, "snapshot write failed");
+            if (::fsync(fd) != 0) ThrowErrno("snapshot fsync failed");
+        }
+        catch (...) {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
+        fs::rename(tmp_path, dir_ / const_values::SNAPSHOT_FILE);
+        SyncDirectory(dir_);
+    }
+
+    std::optional<std::pair<Lsn, std::string>> SnapshotFile::Load () const {
+        const auto path = dir_ / const_values::SNAPSHOT_FILE;
+        if (not fs::exists(path)) return std::nullopt;
+        std::string content = ReadWholeFile(path);
+        std::string_view in = content;
+
+        std::uint32_t magic = 0;
+        Lsn lsn = 0;
+        std::uint64_t size = 0;
+        std::uint32_t checksum = 0;
+        if (not GetRaw(in, magic) || magic != SNAPSHOT_MAGIC ||
+            not GetRaw(in, lsn) || not GetRaw(in, size) || not GetRaw(in, checksum) ||
+            in.size() != size) {
+            throw std::runtime_error("corrupted snapshot " + path.string());
+        }
+        boost::crc_32_type crc;
+        crc.process_bytes(in.data(), in.size());
+        if (crc.checksum() != checksum) throw std::runtime_error("corrupted snapshot " + path.string());
+        return std::make_pair(lsn, std::string(in));
+    }
+
+}//!namespace
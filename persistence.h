@@ -0,0 +1,254 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifndef GAME_SERVER_PERSISTENCE_H
+#define GAME_SERVER_PERSISTENCE_H
+
+namespace persistence {
+
+    namespace fs = std::filesystem;
+
+    using Lsn = std::uint64_t;          // log sequence number, 1-based, 0 - "nothing yet"
+    using RecordType = std::uint8_t;    // meaning is up to the persisted state
+
+    struct Record {
+        Lsn lsn {0};
+        RecordType type {0};
+        std::string payload;
+    };
+
+    namespace const_values {
+        static const std::string_view WAL_PREFIX {"wal-"};
+        static const std::string_view WAL_SUFFIX {".log"};
+        static const std::string_view SNAPSHOT_FILE {"snapshot.bin"};
+        static const std::string_view SNAPSHOT_TMP_FILE {"snapshot.bin.tmp"};
+    }
+
+    // Append-only log of compact binary mutation records:
+    // [u32 payload size][u32 crc32][u64 lsn][u8 type][payload].
+    // Append() only copies the record into the pending batch; a background thread
+    // writes whole batches and makes them durable with a single fdatasync (group commit).
+    // A write/fdatasync failure (ENOSPC, EIO) stops the log: the error is rethrown
+    // from every later Append() and WaitDurable(), nothing after it is considered durable.
+    class WriteAheadLog final {
+    public:
+        WriteAheadLog (fs::path dir, Lsn next_lsn);
+        WriteAheadLog (const WriteAheadLog&) = delete;
+        WriteAheadLog& operator= (const WriteAheadLog&) = delete;
+        ~WriteAheadLog ();
+
+        // Throws the writer's error once the log has failed
+        Lsn Append (RecordType type, std::string_view payload);
+        // Blocks until every record up to lsn is on disk, throws the writer's error if it never gets there
+        void WaitDurable (Lsn lsn);
+        // Records appended after this call go to a new segment starting at the returned lsn
+        Lsn Rotate ();
+        // Drops segments holding only records up to (and including) lsn
+        void DropSegmentsUpTo (Lsn lsn) const;
+        Lsn LastLsn () const;
+
+        // Calls on_record for each intact record with lsn > after, in order; skips the rest of a segment after a torn record
+        static Lsn Replay (const fs::path &dir, Lsn after, const std::function<void(const Record&)> &on_record);
+
+    private:
+        const fs::path dir_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable has_work_;
+        std::condition_variable durable_cv_;
+        std::string pending_;       // batch for the current segment
+        std::string sealed_;        // batch for the segment closed by Rotate()
+        bool rotate_requested_ {false};
+        Lsn next_lsn_;
+        Lsn segment_first_lsn_;
+        Lsn durable_lsn_;
+        bool stop_ {false};
+        std::exception_ptr failure_;    // set by the writer, the log accepts nothing after it
+
+        int fd_ {-1};
+        std::thread writer_;
+
+        void WriterLoop ();
+        void OpenSegment (Lsn first_lsn);
+        void WriteDurably (const std::string &batch) const;
+    };
+
+    // Single snapshot file, replaced atomically (tmp + fsync + rename)
+    class SnapshotFile final {
+    public:
+        explicit SnapshotFile (fs::path dir);
+
+        void Write (Lsn lsn, std::string_view data) const;
+        // lsn of the last record included and the serialized state
+        std::optional<std::pair<Lsn, std::string>> Load () const;
+
+    private:
+        const fs::path dir_;
+    };
+
+    // Owns the dynamic state and keeps it recoverable.
+    // State must provide:
+    //     void Apply (const persistence::Record &record);     // must not throw: validate before Mutate
+    //     std::string Serialize () const;
+    //     static State Deserialize (std::string_view data);
+    //     copy construction (once, at startup)
+    // Double buffered: requests mutate the live state in place, the snapshot thread keeps a second
+    // copy and brings it up to date by applying the records logged since its previous snapshot.
+    // Serializing that copy blocks nobody and no request ever copies the state; the price is
+    // twice the memory and the records of one snapshot period kept in memory.
+    template <typename State>
+    class Persister final {
+    public:
+        Persister (fs::path dir, std::chrono::milliseconds snapshot_period);
+        Persister (const Persister&) = delete;
+        Persister& operator= (const Persister&) = delete;
+        ~Persister ();
+
+        // Logs the record first, the state only changes once the log took it
+        Lsn Mutate (RecordType type, std::string payload);
+        // Calls fn with the state under a shared lock and returns what it returns
+        template <typename Fn>
+        decltype(auto) Read (Fn &&fn) const;
+        void WaitDurable (Lsn lsn);
+        void SnapshotNow ();
+
+    private:
+        const fs::path dir_;
+        const std::chrono::milliseconds snapshot_period_;
+        SnapshotFile snapshot_file_;
+
+        mutable std::shared_mutex state_mutex_;
+        std::unique_ptr<State> state_;
+        std::vector<Record> unsnapshotted_;     // logged since the last snapshot, not yet in shadow_
+        std::unique_ptr<WriteAheadLog> wal_;
+
+        std::mutex shadow_mutex_;               // one snapshot at a time
+        std::unique_ptr<State> shadow_;         // state as of the last snapshot, null after a failed Apply
+
+        std::mutex snapshot_mutex_;
+        std::condition_variable snapshot_cv_;
+        bool stop_ {false};
+        std::thread snapshotter_;
+
+        Lsn Recover ();
+        void SnapshotLoop ();
+    };
+
+    template <typename State>
+    Persister<State>::Persister (fs::path dir, std::chrono::milliseconds snapshot_period)
+            : dir_(std::move(dir))
+            , snapshot_period_(snapshot_period)
+            , snapshot_file_(dir_) {
+        fs::create_directories(dir_);
+        const Lsn last_lsn = Recover();
+        shadow_ = std::make_unique<State>(*state_);
+        wal_ = std::make_unique<WriteAheadLog>(dir_, last_lsn + 1);
+        snapshotter_ = std::thread([this] { SnapshotLoop(); });
+    }
+
+    template <typename State>
+    Persister<State>::~Persister () {
+        {
+            std::lock_guard lock(snapshot_mutex_);
+            stop_ = true;
+        }
+        snapshot_cv_.notify_all();
+        if (snapshotter_.joinable()) snapshotter_.join();
+    }
+
+    template <typename State>
+    Lsn Persister<State>::Recover () {
+        Lsn last_lsn = 0;
+        if (auto snapshot = snapshot_file_.Load(); snapshot) {
+            last_lsn = snapshot->first;
+            state_ = std::make_unique<State>(State::Deserialize(snapshot->second));
+        }
+        else {
+            state_ = std::make_unique<State>();
+        }
+        return WriteAheadLog::Replay(dir_, last_lsn, [this](const Record &record) {
+            state_->Apply(record);
+        });
+    }
+
+    template <typename State>
+    Lsn Persister<State>::Mutate (RecordType type, std::string payload) {
+        std::unique_lock lock(state_mutex_);
+        const Lsn lsn = wal_->Append(type, payload);
+        unsnapshotted_.push_back(Record {lsn, type, std::move(payload)});
+        state_->Apply(unsnapshotted_.back());
+        return lsn;
+    }
+
+    template <typename State>
+    template <typename Fn>
+    decltype(auto) Persister<State>::Read (Fn &&fn) const {
+        std::shared_lock lock(state_mutex_);
+        return std::forward<Fn>(fn)(static_cast<const State&>(*state_));
+    }
+
+    template <typename State>
+    void Persister<State>::WaitDurable (Lsn lsn) {
+        wal_->WaitDurable(lsn);
+    }
+
+    template <typename State>
+    void Persister<State>::SnapshotNow () {
+        std::lock_guard shadow_lock(shadow_mutex_);
+        std::vector<Record> records;
+        Lsn last_lsn = 0;
+        {
+            std::unique_lock lock(state_mutex_);
+            records.swap(unsnapshotted_);
+            last_lsn = wal_->Rotate() - 1;
+            if (not shadow_) {
+                // a previous catch-up failed half way: start over from the live state, the only full copy
+                shadow_ = std::make_unique<State>(*state_);
+                records.clear();
+            }
+        }
+        try {
+            for (const auto &record : records) shadow_->Apply(record);
+        }
+        catch (...) {
+            shadow_.reset();
+            throw;
+        }
+        snapshot_file_.Write(last_lsn, shadow_->Serialize());
+        wal_->DropSegmentsUpTo(last_lsn);
+    }
+
+    template <typename State>
+    void Persister<State>::SnapshotLoop () {
+        std::unique_lock lock(snapshot_mutex_);
+        while (not stop_) {
+            snapshot_cv_.wait_for(lock, snapshot_period_, [this] { return stop_; });
+            if (stop_) break;
+            lock.unlock();
+            try {
+                SnapshotNow();
+            }
+            catch (const std::exception&) {
+                // keep going: the WAL still holds everything since the previous snapshot
+            }
+            lock.lock();
+        }
+    }
+
+}//!namespace
+
+#endif //GAME_SERVER_PERSISTENCE_H
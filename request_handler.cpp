@@ -2,19 +2,88 @@
 
 namespace http_handler {
 
+    namespace {
+
+        // "//api//v1/maps/" -> "/api/v1/maps"
+        std::string NormalizeTarget (const std::string_view target) {
+            std::string normalized;
+            normalized.reserve(target.size());
+            for (const char c : target) {
+                if (c == api::const_values::URI_DELIM &&
+                    not normalized.empty() &&
+                    normalized.back() == api::const_values::URI_DELIM)
+                    continue;
+                normalized += c;
+            }
+            if (normalized.size() > 1u && normalized.back() == api::const_values::URI_DELIM) normalized.pop_back();
+            return normalized;
+        }
+
+        // String bodies are moved into a shared immutable buffer, so waiters copy only the header
+        resources::WorkerResponse MakeShareable (resources::WorkerResponse &&res_holder) {
+            using namespace types::response;
+            if (auto p_str = res_holder.template TryAs<Str>(); p_str) {
+                auto body = std::make_shared<const std::string>(std::move(p_str->body()));
+                return resources::WorkerResponse {SharedStr {std::move(p_str->base()), std::move(body)}};
+            }
+            return std::move(res_holder);
+        }
+
+        resources::WorkerResponse CoalescingTimeout () {
+            types::response::Str res;
+            res.result(http::status::service_unavailable);
+            res.set(http::field::content_type, "application/json");
+            res.set(http::field::retry_after, "1");
+            res.body() = R"({"code":"serverBusy","message":"Identical request is still being processed"})";
+            res.prepare_payload();
+            return {std::move(res)};
+        }
+
+        resources::WorkerResponse CoalescingFailure () {
+            types::response::Str res;
+            res.result(http::status::internal_server_error);
+            res.set(http::field::content_type, "application/json");
+            res.body() = R"({"code":"internalError","message":"Response can't be shared"})";
+            res.prepare_payload();
+            return {std::move(res)};
+        }
+
+        // nullopt for responses owning a resource (file body), those can't be shared
+        std::optional<resources::WorkerResponse> CopyShared (const resources::WorkerResponse &res_holder) {
+            return std::visit([](const auto &res) -> std::optional<resources::WorkerResponse> {
+                if constexpr (std::is_copy_constructible_v<std::decay_t<decltype(res)>>) {
+                    return resources::WorkerResponse {res};
+                }
+                else {
+                    return std::nullopt;
+                }
+            }, res_holder.GetValue());
+        }
+
+    }//!namespace
+
     RequestHandler::RequestHandler(model::Game& game, fs::path &&root)
             : workers_(game, std::move(root)) {
         TemporaryInit();
     }
 
 
+    void RequestHandler::EnableSharding (std::shared_ptr<sharding::Router> router) {
+        router_ = std::move(router);
+        RegisterForwardedResource (http::verb::get, "/api/v1/maps"sv, Error{});   // maps unknown to the front
+        RegisterForwardedResource (http::verb::get, "/api/v1/maps/map1"sv, Success{});
+    }
+
     void RequestHandler::TemporaryInit () {
         using namespace resources;
         auto bad_request = &Workers::BadRequest;
         auto map_not_found = &Workers::MapNotFound;
         auto single_map = &Workers::SingleMap;
         auto all_maps = &Workers::AllMaps;
+        auto maps_batch = &Workers::MapsBatch;
         auto file = &Workers::File;
+        auto debug_cpu_profile = &Workers::DebugCpuProfile;
+        auto debug_allocations = &Workers::DebugAllocations;
 
         RegisterResource (http::verb::get, "/api"sv, AnyQuery{}, bad_request);
         RegisterResource (http::verb::get, "/api/v1"sv, AnyQuery{}, bad_request);
@@ -22,28 +91,70 @@ namespace http_handler {
         RegisterResource (http::verb::get, "/api/v1/maps"sv, Success{}, all_maps);
         RegisterResource (http::verb::get, "/api/v1/maps/map1"sv, Error{}, bad_request);
         RegisterResource (http::verb::get, "/api/v1/maps/map1"sv, Success{}, single_map);
+        RegisterResource (http::verb::get, "/api/v1/maps/batch"sv, Error{}, bad_request);
+        RegisterResource (http::verb::get, "/api/v1/maps/batch"sv, Success{}, maps_batch);
+
+        RegisterResource (http::verb::get, "/api/v1/debug/profile"sv, AnyQuery{}, debug_cpu_profile);
+        RegisterResource (http::verb::get, "/api/v1/debug/allocations"sv, AnyQuery{}, debug_allocations);
 
         RegisterResource (http::verb::get, "/file"sv, AnyQuery{}, file);
+        file_endpoint_ = uri_handler_.tryGetApiEndpoint("/file"sv);
+    }
+
+    bool RequestHandler::IsForwarded (http::verb verb, const std::string_view target) const {
+        if (not router_) return false;
+        const auto [ok, derived_path] = uri_handler_.resolvePath(target.substr(0, target.find('?')));
+        if (not derived_path.has_value() || derived_path.value().empty()) return false;
+        return forwarded_.count({derived_path.value().back().get(), static_cast<int>(verb), ok}) != 0u;
+    }
+
+    std::string_view RequestHandler::RouteOf (const api::Path::ResolutionResult &resolution) const {
+        const auto &derived_path = resolution.second;
+        if (not derived_path.has_value() || derived_path.value().empty()) return UNMATCHED_ROUTE;
+        // paths the tree doesn't know stop at their deepest known endpoint, the root one serves files
+        const auto &endpoint = uri_handler_.isRoot(derived_path.value().back())
+                ? file_endpoint_
+                : derived_path.value().back();
+        const auto found = routes_.find(endpoint.get());
+        return found == routes_.end() ? UNMATCHED_ROUTE : std::string_view(found->second);
     }
 
     resources::WorkerResponse RequestHandler::CallResource (
             http::verb verb,
+            const api::Path::ResolutionResult &resolution,
             const std::string_view path,
-            const std::string_view data) const {
-        const auto [ok, derived_path] = uri_handler_.resolvePath(path);
+            const std::string_view data,
+            const std::string_view encoding) const {
+        const auto &[ok, derived_path] = resolution;
         const bool is_request_to_file = (
                 derived_path.has_value() &&
                 derived_path.value().size() == 1u &&
                 uri_handler_.isRoot(derived_path.value().back()));
         if (is_request_to_file) {
-            if (const auto file_api = uri_handler_.tryGetApiEndpoint("/file"); file_api) {
-                return file_api->callWorker(static_cast<int>(verb), true, path, workers_);;
+            if (file_endpoint_) {
+                return file_endpoint_->callWorker(static_cast<int>(verb), true, path, workers_);
             }
             else {
                 return resources::WorkerResponse {}; //will be processed while decorating response
             }
         }
-        return derived_path->back()->callWorker(static_cast<int>(verb), ok, data, workers_);
+        const auto endpoint = derived_path->back();
+        if (endpoint == file_endpoint_) return endpoint->callWorker(static_cast<int>(verb), ok, data, workers_);
+        std::string target = NormalizeTarget(path);
+        if (not data.empty()) {
+            target += '?';
+            target += data;
+        }
+        CoalescingKey key {endpoint.get(), static_cast<int>(verb), std::move(target), std::string(encoding)};
+        const auto shared = in_flight_.Do(key, [&] {
+            return MakeShareable(endpoint->callWorker(static_cast<int>(verb), ok, data, workers_));
+        }, COALESCING_MAX_WAIT);
+        // gave up waiting for the first identical request, repeating its work would only add load
+        if (not shared) return CoalescingTimeout();
+        // only files own a resource, and they don't go through coalescing
+        auto copy = CopyShared(*shared);
+        if (not copy) return CoalescingFailure();
+        return std::move(*copy);
     }
 
     resources::WorkerResponse RequestHandler::PopulateResponse(resources::WorkerResponse &&res_holder,
@@ -61,8 +172,11 @@ namespace http_handler {
         else if (auto p_empty = res_holder.template TryAs<Empty>(); p_empty) {
             PopulateResponseHelper(*p_empty, http_version, keep_alive, content_type);
         }
+        else if (auto p_shared = res_holder.template TryAs<SharedStr>(); p_shared) {
+            PopulateResponseHelper(*p_shared, http_version, keep_alive, content_type);
+        }
         else {
-            http::response<http::string_body> res;
+            Str res;
             res.body() = "I donno know nothin\'";
             res.result(http::status::not_found);
             res.prepare_payload();
@@ -73,5 +187,24 @@ namespace http_handler {
         return res_holder;
     }
 
+    void RequestHandler::LogAccess (std::string_view method,
+                                    std::string_view route,
+                                    const resources::WorkerResponse &res_holder,
+                                    std::chrono::nanoseconds duration) const {
+        if (not logging::Logger::Instance().IsEnabled(logging::Level::Info)) return;
+        logging::AccessRecord record;
+        record.timestamp = logging::Clock::now();
+        record.SetMethod(method);
+        record.SetRoute(route);
+        record.duration = duration;
+        std::visit([&record](const auto &res) {
+            if constexpr (not std::is_same_v<std::decay_t<decltype(res)>, types::response::None>) {
+                record.status = res.result_int();
+                record.bytes = res.payload_size().value_or(0u);
+            }
+        }, res_holder.GetValue());
+        logging::LogAccess(record);
+    }
+
 
 }  // namespace http_handler
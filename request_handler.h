@@ -3,7 +3,16 @@
 #include "http_server.h"
 #include "model.h"
 #include "uri.h"
+#include "logger.h"
+#include "single_flight.h"
+#include "debug_profiler.h"
+#include "shard_router.h"
 
+#include <chrono>
+#include <memory>
+#include <set>
+#include <tuple>
+#include <unordered_map>
 #include <vector>
 #include <filesystem>
 
@@ -36,6 +45,32 @@ namespace http_handler {
         };
 
         const std::string ALLOWED_METHODS {"GET,HEAD"};
+        constexpr static std::string_view UNMATCHED_ROUTE = "unmatched"sv;
+        // A waiter blocks its I/O thread for up to this long; past it the request gets 503
+        constexpr static std::chrono::milliseconds COALESCING_MAX_WAIT {500};
+
+        // Identical concurrent requests share one worker call. Files aren't coalesced:
+        // a file body owns its descriptor and can't be handed to the waiters
+        struct CoalescingKey {
+            const api::Endpoint *endpoint;
+            int verb;
+            std::string target;
+            std::string encoding;
+
+            bool operator== (const CoalescingKey &other) const = default;
+        };
+        struct CoalescingKeyHasher {
+            size_t operator () (const CoalescingKey &key) const {
+                return
+                        p_hash(key.endpoint) * 37u +
+                        i_hash(key.verb) * 17u +
+                        s_hash(key.target) * 7u +
+                        s_hash(key.encoding);
+            }
+            std::hash<const api::Endpoint*> p_hash;
+            std::hash<int> i_hash;
+            std::hash<std::string> s_hash;
+        };
 
     public:
         explicit RequestHandler(model::Game& game, fs::path &&root);
@@ -50,9 +85,24 @@ namespace http_handler {
                                const std::string_view path,
                                const Result path_resolution_result,
                                resources::Worker worker);
+
+        // Requests resolved to this endpoint/result go to the map backends instead of workers
+        template <typename Result>
+        bool RegisterForwardedResource (const http::verb verb,
+                                        const std::string_view path,
+                                        const Result path_resolution_result);
+
+        // Front process mode: map requests are forwarded, files and map lists stay local
+        void EnableSharding (std::shared_ptr<sharding::Router> router);
     private:
         resources::Workers workers_;
         api::Tree uri_handler_;
+        mutable coalescing::SingleFlight<CoalescingKey, resources::WorkerResponse, CoalescingKeyHasher> in_flight_;
+        std::shared_ptr<sharding::Router> router_;
+        std::set<std::tuple<const api::Endpoint*, int, bool>> forwarded_;
+        api::EndpointPtr file_endpoint_;
+        // Route pattern each endpoint was registered with, allocation stats are kept per pattern
+        std::unordered_map<const api::Endpoint*, std::string> routes_;
 
         //todo: transform into reusable solution,
         // move Resource Initialization to AddMap or After as a separate Initialization procedure
@@ -60,9 +110,18 @@ namespace http_handler {
 
         auto HandleRequest(auto&& req);
 
+        // Forwarded requests don't wait on a front thread: send is called when the backend answers
+        bool IsForwarded (http::verb verb, const std::string_view target) const;
+        template <typename Request, typename Send>
+        void ForwardRequest (Request &&req, Send &&send);
+
+        std::string_view RouteOf (const api::Path::ResolutionResult &resolution) const;
+
         resources::WorkerResponse CallResource (http::verb verb,
+                const api::Path::ResolutionResult &resolution,
                 const std::string_view path,
-                const std::string_view data) const;
+                const std::string_view data,
+                const std::string_view encoding) const;
 
 
         resources::WorkerResponse PopulateResponse(resources::WorkerResponse &&res_holder,
@@ -71,16 +130,24 @@ namespace http_handler {
                                                    std::string_view content_type = ContentType::APPLICATION_JSON) const;
 
         template <typename Body>
-        void PopulateResponseHelper (http::response<Body> &res,
+        void PopulateResponseHelper (http::response<Body, types::response::Fields> &res,
                  unsigned http_version,
                  bool keep_alive,
                  std::string_view content_type = ContentType::APPLICATION_JSON) const;
 
+        void LogAccess (std::string_view method,
+                        std::string_view route,
+                        const resources::WorkerResponse &res_holder,
+                        std::chrono::nanoseconds duration) const;
+
     };//!class
 
     template <typename Body, typename Allocator, typename Send>
     void RequestHandler::operator()(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
         // Обработать запрос request и отправить ответ, используя send
+        if (IsForwarded(req.method(), {req.target().data(), req.target().size()})) {
+            return ForwardRequest(std::move(req), std::forward<Send>(send));
+        }
         auto response = HandleRequest(std::move(req));
         send(std::move(response)); //todo: initially there was no "move"
     }
@@ -109,6 +176,7 @@ namespace http_handler {
         const auto resource_call_options = GetResourceCallOptions(path_resolution_result);
         const auto [path_resolved_ok, endpoint] = uri_handler_.addApiEndpoint(path);
         if (not endpoint || not path_resolved_ok) return not success; //not endpoint - extra check
+        routes_.try_emplace(endpoint.get(), path);
         for (const auto call_option : resource_call_options) {
             bool inserted = endpoint->registerWorker(
                     static_cast<int>(verb),
@@ -119,20 +187,68 @@ namespace http_handler {
         return success;
     }
 
+    template <typename Result>
+    bool RequestHandler::RegisterForwardedResource (
+            const http::verb verb,
+            const std::string_view path,
+            const Result path_resolution_result) {
+        const auto resource_call_options = GetResourceCallOptions(path_resolution_result);
+        const auto [path_resolved_ok, endpoint] = uri_handler_.addApiEndpoint(path);
+        if (not endpoint || not path_resolved_ok) return false;
+        for (const auto call_option : resource_call_options) {
+            forwarded_.emplace(endpoint.get(), static_cast<int>(verb), call_option);
+        }
+        return true;
+    }
+
     auto RequestHandler::HandleRequest(auto&& req) {
-        const std::string path = {req.target().begin(), req.target().end()};
-        auto res_holder = CallResource(req.method(), path, ""s);
+        const auto start = std::chrono::steady_clock::now();
+        const std::string target = {req.target().begin(), req.target().end()};
+        const auto query_pos = target.find('?');
+        const std::string_view path = std::string_view(target).substr(0, query_pos);
+        const std::string_view query = query_pos == std::string::npos
+                ? ""sv
+                : std::string_view(target).substr(query_pos + 1);
+        const auto encoding = req[http::field::accept_encoding];
+        const auto resolution = uri_handler_.resolvePath(path);
+        debug::RouteScope route_scope(RouteOf(resolution));
+        auto res_holder = CallResource(req.method(), resolution, path, query, {encoding.data(), encoding.size()});
         res_holder = PopulateResponse(std::move(res_holder), req.version(), req.keep_alive());
+        const auto method = req.method_string();
+        LogAccess({method.data(), method.size()}, path, res_holder, std::chrono::steady_clock::now() - start);
         return res_holder;
     }
 
+    template <typename Request, typename Send>
+    void RequestHandler::ForwardRequest (Request &&req, Send &&send) {
+        const auto start = std::chrono::steady_clock::now();
+        const std::string target = {req.target().begin(), req.target().end()};
+        const auto query_pos = target.find('?');
+        std::string path = target.substr(0, query_pos);
+        const std::string_view query = query_pos == std::string::npos
+                ? ""sv
+                : std::string_view(target).substr(query_pos + 1);
+        const auto method = req.method_string();
+        // Send may be move-only, the router's callback has to be copyable
+        auto p_send = std::make_shared<std::decay_t<Send>>(std::forward<Send>(send));
+        router_->Forward(req.method(), path, query,
+                         [this, p_send, start, path,
+                          method = std::string(method.data(), method.size()),
+                          version = req.version(),
+                          keep_alive = req.keep_alive()](types::HttpResponse &&response) {
+            auto res_holder = PopulateResponse(std::move(response), version, keep_alive);
+            LogAccess(method, path, res_holder, std::chrono::steady_clock::now() - start);
+            (*p_send)(std::move(res_holder));
+        });
+    }
+
     template <typename Body>
-    void RequestHandler::PopulateResponseHelper (http::response<Body> &res,
+    void RequestHandler::PopulateResponseHelper (http::response<Body, types::response::Fields> &res,
                              unsigned http_version,
                              bool keep_alive,
                              std::string_view content_type) const {
         res.version(http_version);
-        res.set(http::field::content_type, content_type);
+        if (res[http::field::content_type].empty()) res.set(http::field::content_type, content_type);
         res.set(http::field::allow, ALLOWED_METHODS);
         res.keep_alive(keep_alive);
     }
@@ -0,0 +1,243 @@
+#include "shard_router.h"
+
+#include <functional>
+
+namespace sharding {
+
+    namespace {
+
+        const std::string_view SHARD_UNAVAILABLE_BODY {
+                R"({"code":"shardUnavailable","message":"Map backend is unavailable"})"};
+
+        types::HttpResponse ShardUnavailable () {
+            types::response::Str res;
+            res.result(http::status::service_unavailable);
+            res.set(http::field::content_type, "application/json");
+            res.body() = std::string(SHARD_UNAVAILABLE_BODY);
+            res.prepare_payload();
+            return {std::move(res)};
+        }
+
+    }//!namespace
+
+    ShardMap::ShardMap (size_t backend_count, std::unordered_map<std::string, size_t> assignment)
+            : backend_count_(backend_count)
+            , assignment_(std::move(assignment)) {
+        if (backend_count_ == 0) throw std::invalid_argument("no map backends");
+        for (const auto &[map_id, backend] : assignment_) {
+            if (backend >= backend_count_) throw std::invalid_argument("map assigned to unknown backend");
+        }
+    }
+
+    size_t ShardMap::BackendFor (std::string_view map_id) const {
+        if (auto found = assignment_.find(std::string(map_id)); found != assignment_.end()) {
+            return found->second;
+        }
+        return std::hash<std::string_view>{}(map_id) % backend_count_;
+    }
+
+    size_t ShardMap::BackendCount () const {
+        return backend_count_;
+    }
+
+    struct BackendPool::Connection {
+        explicit Connection (net::io_context &ioc)
+                : socket(ioc)
+        {}
+
+        local::socket socket;
+        beast::basic_flat_buffer<memory::PoolAllocator<char>> buffer;
+    };
+
+    // One request/response on one connection. Every handler runs on strand_, so the deadline
+    // can close the socket while an operation is pending.
+    class BackendPool::Exchange final : public std::enable_shared_from_this<Exchange> {
+    public:
+        Exchange (std::shared_ptr<BackendPool> pool, http::request<http::string_body> &&request, Callback &&callback)
+                : pool_(std::move(pool))
+                , strand_(net::make_strand(pool_->ioc_))
+                , deadline_(strand_)
+                , request_(std::move(request))
+                , callback_(std::move(callback))
+        {}
+
+        void Start () {
+            net::dispatch(strand_, [self = shared_from_this()] {
+                self->deadline_.expires_after(const_values::BACKEND_TIMEOUT);
+                self->deadline_.async_wait([self](beast::error_code ec) {
+                    if (not ec) self->OnDeadline();
+                });
+                self->Attempt(true);
+            });
+        }
+
+    private:
+        std::shared_ptr<BackendPool> pool_;
+        net::strand<net::io_context::executor_type> strand_;
+        net::steady_timer deadline_;
+        http::request<http::string_body> request_;
+        Callback callback_;
+        std::unique_ptr<Connection> connection_;
+        types::response::Str response_;
+        bool reused_ {false};
+        bool timed_out_ {false};
+
+        void Attempt (bool may_reuse) {
+            connection_ = may_reuse ? pool_->TakeIdle() : nullptr;
+            reused_ = connection_ != nullptr;
+            if (reused_) return Write();
+            connection_ = std::make_unique<Connection>(pool_->ioc_);
+            connection_->socket.async_connect(local::endpoint(pool_->socket_path_.string()),
+                                              net::bind_executor(strand_, [self = shared_from_this()](beast::error_code ec) {
+                if (ec) return self->Fail(ec);
+                self->Write();
+            }));
+        }
+
+        void Write () {
+            http::async_write(connection_->socket, request_,
+                              net::bind_executor(strand_, [self = shared_from_this()](beast::error_code ec, size_t) {
+                if (ec) return self->Fail(ec);
+                self->Read();
+            }));
+        }
+
+        void Read () {
+            response_ = {};
+            http::async_read(connection_->socket, connection_->buffer, response_,
+                             net::bind_executor(strand_, [self = shared_from_this()](beast::error_code ec, size_t) {
+                if (ec) return self->Fail(ec);
+                if (self->response_.keep_alive()) self->pool_->Release(std::move(self->connection_));
+                self->Finish(std::move(self->response_));
+            }));
+        }
+
+        void Fail (beast::error_code ec) {
+            connection_.reset();
+            // The backend may have closed a pooled connection while it sat idle, that shows right away
+            // as EOF or reset: retry once on a fresh one. Never after the deadline fired.
+            if (reused_ && not timed_out_ && IsStaleConnection(ec)) return Attempt(false);
+            Finish(std::nullopt);
+        }
+
+        void OnDeadline () {
+            timed_out_ = true;
+            if (connection_) {
+                beast::error_code ignored;
+                connection_->socket.close(ignored);     // the pending operation fails with operation_aborted
+            }
+        }
+
+        void Finish (std::optional<types::response::Str> &&response) {
+            deadline_.cancel();
+            callback_(std::move(response));
+        }
+
+        static bool IsStaleConnection (beast::error_code ec) {
+            return ec == http::error::end_of_stream ||
+                   ec == net::error::eof ||
+                   ec == net::error::connection_reset ||
+                   ec == net::error::broken_pipe;
+        }
+    };
+
+    BackendPool::BackendPool (net::io_context &ioc, fs::path socket_path)
+            : ioc_(ioc)
+            , socket_path_(std::move(socket_path))
+    {}
+
+    BackendPool::~BackendPool () = default;
+
+    void BackendPool::AsyncSend (http::request<http::string_body> &&request, Callback &&callback) {
+        std::make_shared<Exchange>(shared_from_this(), std::move(request), std::move(callback))->Start();
+    }
+
+    std::unique_ptr<BackendPool::Connection> BackendPool::TakeIdle () {
+        std::lock_guard lock(mutex_);
+        if (idle_.empty()) return nullptr;
+        auto connection = std::move(idle_.back());
+        idle_.pop_back();
+        return connection;
+    }
+
+    void BackendPool::Release (std::unique_ptr<Connection> connection) {
+        std::lock_guard lock(mutex_);
+        if (idle_.size() < const_values::MAX_IDLE_CONNECTIONS) idle_.push_back(std::move(connection));
+    }
+
+    Router::Router (net::io_context &ioc, std::vector<fs::path> backend_sockets, ShardMap shard_map)
+            : shard_map_(std::move(shard_map)) {
+        if (backend_sockets.size() != shard_map_.BackendCount()) {
+            throw std::invalid_argument("shard map doesn't match backends");
+        }
+        for (auto &socket_path : backend_sockets) {
+            backends_.push_back(std::make_shared<BackendPool>(ioc, std::move(socket_path)));
+        }
+    }
+
+    std::optional<std::string_view> Router::MapIdOf (std::string_view path, std::string_view query) {
+        if (auto pos = path.find(const_values::MAPS_SEGMENT); pos != std::string_view::npos) {
+            auto id = path.substr(pos + const_values::MAPS_SEGMENT.size());
+            id = id.substr(0, id.find('/'));
+            if (not id.empty()) return id;
+        }
+        while (not query.empty()) {
+            const auto param = query.substr(0, query.find('&'));
+            if (param.size() > const_values::MAP_QUERY_PARAM.size() &&
+                param.substr(0, const_values::MAP_QUERY_PARAM.size()) == const_values::MAP_QUERY_PARAM &&
+                param[const_values::MAP_QUERY_PARAM.size()] == '=') {
+                return param.substr(const_values::MAP_QUERY_PARAM.size() + 1);
+            }
+            if (param.size() == query.size()) break;
+            query.remove_prefix(param.size() + 1);
+        }
+        return std::nullopt;
+    }
+
+    void Router::Forward (http::verb verb, std::string_view path, std::string_view query, Callback callback) {
+        const auto map_id = MapIdOf(path, query);
+        const size_t backend = map_id ? shard_map_.BackendFor(*map_id) : 0u;
+
+        std::string target(path);
+        if (not query.empty()) {
+            target += '?';
+            target += query;
+        }
+        std::string key(http::to_string(verb));
+        key += ' ';
+        key += target;
+        {
+            std::lock_guard lock(in_flight_mutex_);
+            auto [entry, first] = in_flight_.try_emplace(key);
+            entry->second.push_back(std::move(callback));
+            if (not first) return;
+        }
+
+        http::request<http::string_body> request {verb, target, 11};
+        request.set(http::field::host, "localhost");
+        request.keep_alive(true);
+        backends_[backend]->AsyncSend(std::move(request),
+                                      [self = shared_from_this(), key = std::move(key)](auto &&response) {
+            self->Complete(key, std::move(response));
+        });
+    }
+
+    void Router::Complete (const std::string &key, std::optional<types::response::Str> &&response) {
+        std::vector<Callback> waiters;
+        {
+            std::lock_guard lock(in_flight_mutex_);
+            waiters = std::move(in_flight_.extract(key).mapped());
+        }
+        if (not response) {
+            for (auto &waiter : waiters) waiter(ShardUnavailable());
+            return;
+        }
+        if (waiters.size() == 1u) return waiters.front()({std::move(*response)});
+        // waiters copy only the header
+        auto body = std::make_shared<const std::string>(std::move(response->body()));
+        for (auto &waiter : waiters) {
+            waiter({types::response::SharedStr {response->base(), body}});
+        }
+    }
+
+}//!namespace
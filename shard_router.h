@@ -0,0 +1,236 @@
+#pragma once
+
+#include "http_response_type.h"
+#include "slab_pool.h"
+#include "timeout_service.h"
+
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#ifndef GAME_SERVER_SHARD_ROUTER_H
+#define GAME_SERVER_SHARD_ROUTER_H
+
+// Multi-process deployment: a front process owns the listeners, serves static files and
+// cached maps itself and forwards map/game requests over Unix domain sockets to backend
+// processes running a BackendListener. Every process still loads the whole game: splitting
+// what a backend loads is up to the game loader, which lives outside this tree.
+
+namespace sharding {
+
+    namespace net = boost::asio;
+    namespace beast = boost::beast;
+    namespace http = beast::http;
+    namespace fs = std::filesystem;
+    using local = net::local::stream_protocol;
+
+    namespace const_values {
+        static const std::chrono::milliseconds BACKEND_TIMEOUT {5000};  // whole exchange, retry included
+        static const size_t MAX_IDLE_CONNECTIONS {32u};
+        static const std::string_view MAPS_SEGMENT {"/maps/"};
+        static const std::string_view MAP_QUERY_PARAM {"map"};
+        static const std::chrono::milliseconds TIMEOUT_TICK {100};
+        static const std::chrono::seconds FIRST_REQUEST_TIMEOUT {15};   // connected but silent
+        static const std::chrono::seconds IDLE_TIMEOUT {60};            // keep-alive between requests
+    }
+
+    // Which backend owns which map: explicit assignment first, hash of the id otherwise
+    class ShardMap final {
+    public:
+        ShardMap (size_t backend_count, std::unordered_map<std::string, size_t> assignment = {});
+
+        size_t BackendFor (std::string_view map_id) const;
+        size_t BackendCount () const;
+
+    private:
+        size_t backend_count_;
+        std::unordered_map<std::string, size_t> assignment_;
+    };
+
+    // Keep-alive connections to one backend. Exchanges run asynchronously on the front's io_context,
+    // each on a strand of its own and under one deadline, so a hung backend fails only its own
+    // requests and never holds a front thread. The io_context must outlive the pool.
+    class BackendPool final : public std::enable_shared_from_this<BackendPool> {
+    public:
+        // nullopt when the backend is down or too slow
+        using Callback = std::function<void (std::optional<types::response::Str> &&response)>;
+
+        BackendPool (net::io_context &ioc, fs::path socket_path);
+        BackendPool (const BackendPool&) = delete;
+        BackendPool& operator= (const BackendPool&) = delete;
+        ~BackendPool ();
+
+        // callback runs on a thread of the io_context
+        void AsyncSend (http::request<http::string_body> &&request, Callback &&callback);
+
+    private:
+        struct Connection;
+        class Exchange;
+
+        net::io_context &ioc_;
+        const fs::path socket_path_;
+        std::mutex mutex_;
+        std::vector<std::unique_ptr<Connection>> idle_;
+
+        std::unique_ptr<Connection> TakeIdle ();
+        void Release (std::unique_ptr<Connection> connection);
+    };
+
+    // Create with std::make_shared: exchanges in flight keep the router alive
+    class Router final : public std::enable_shared_from_this<Router> {
+    public:
+        using Callback = std::function<void (types::HttpResponse &&response)>;
+
+        Router (net::io_context &ioc, std::vector<fs::path> backend_sockets, ShardMap shard_map);
+
+        // Asynchronous, callback runs on a thread of ioc. Backend failures come back as 503
+        // for maps of an unavailable backend. Identical concurrent requests share one exchange.
+        void Forward (http::verb verb, std::string_view path, std::string_view query, Callback callback);
+
+        // "/api/v1/maps/map1" -> "map1", "...?map=map1" -> "map1"
+        static std::optional<std::string_view> MapIdOf (std::string_view path, std::string_view query);
+
+    private:
+        ShardMap shard_map_;
+        std::vector<std::shared_ptr<BackendPool>> backends_;
+        std::mutex in_flight_mutex_;
+        std::unordered_map<std::string, std::vector<Callback>> in_flight_;     // "GET target" -> waiters
+
+        void Complete (const std::string &key, std::optional<types::response::Str> &&response);
+    };
+
+    // Backend side: serves requests coming from the front through the regular request handler.
+    // Sessions, their buffers and header fields come from the slab pool; timeouts from one timing wheel.
+    template <typename RequestHandler>
+    class BackendSession final : public std::enable_shared_from_this<BackendSession<RequestHandler>> {
+    public:
+        using Request = http::request<http::string_body, types::PooledFields>;
+
+        BackendSession (local::socket &&socket,
+                        RequestHandler &handler,
+                        std::shared_ptr<timers::TimeoutService> timeouts)
+                : socket_(std::move(socket))
+                , handler_(handler)
+                , timeouts_(std::move(timeouts))
+        {}
+
+        ~BackendSession () {
+            timeouts_->Disarm(timeout_);
+        }
+
+        void Read () {
+            ArmTimeout(first_request_ ? const_values::FIRST_REQUEST_TIMEOUT : const_values::IDLE_TIMEOUT);
+            first_request_ = false;
+            request_ = {};
+            http::async_read(socket_, buffer_, request_,
+                             [self = this->shared_from_this()](beast::error_code ec, size_t) {
+                self->timeouts_->Disarm(self->timeout_);
+                if (ec) return self->Close();
+                self->handler_(std::move(self->request_), [self](auto &&response) {
+                    self->Write(std::forward<decltype(response)>(response));
+                });
+            });
+        }
+
+    private:
+        local::socket socket_;
+        beast::basic_flat_buffer<memory::PoolAllocator<char>> buffer_;
+        Request request_;
+        RequestHandler &handler_;
+        std::shared_ptr<timers::TimeoutService> timeouts_;
+        timers::TimingWheel::TimerId timeout_;
+        bool first_request_ {true};
+
+        void ArmTimeout (std::chrono::milliseconds timeout) {
+            if (timeouts_->Rearm(timeout_, timeout)) return;
+            std::weak_ptr<BackendSession> weak_self = this->shared_from_this();
+            timeout_ = timeouts_->Arm(timeout, [weak_self] {
+                if (auto self = weak_self.lock(); self) {
+                    // the socket's executor is the session's strand
+                    net::post(self->socket_.get_executor(), [self] {
+                        beast::error_code ec;
+                        self->socket_.close(ec);
+                    });
+                }
+            });
+        }
+
+        void Write (types::HttpResponse &&response) {
+            auto holder = std::make_shared<types::HttpResponse>(std::move(response));
+            std::visit([this, holder](auto &res) {
+                if constexpr (std::is_same_v<std::decay_t<decltype(res)>, types::response::None>) {
+                    Close();
+                }
+                else {
+                    const bool keep_alive = res.keep_alive();
+                    http::async_write(socket_, res,
+                                      [self = this->shared_from_this(), holder, keep_alive](beast::error_code ec, size_t) {
+                        if (ec || not keep_alive) return self->Close();
+                        self->Read();
+                    });
+                }
+            }, holder->GetValue());
+        }
+
+        void Close () {
+            beast::error_code ec;
+            socket_.shutdown(local::socket::shutdown_send, ec);
+        }
+    };
+
+    template <typename RequestHandler>
+    class BackendListener final : public std::enable_shared_from_this<BackendListener<RequestHandler>> {
+    public:
+        BackendListener (net::io_context &ioc, const fs::path &socket_path, RequestHandler &handler)
+                : acceptor_(ioc)
+                , handler_(handler)
+                , timeouts_(std::make_shared<timers::TimeoutService>(ioc, const_values::TIMEOUT_TICK)) {
+            std::error_code ec;
+            fs::remove(socket_path, ec);    // stale socket of a previous run
+            local::endpoint endpoint(socket_path.string());
+            acceptor_.open(endpoint.protocol());
+            acceptor_.bind(endpoint);
+            acceptor_.listen(net::socket_base::max_listen_connections);
+        }
+
+        void Run () {
+            timeouts_->Start();
+            Accept();
+        }
+
+    private:
+        using Session = BackendSession<RequestHandler>;
+
+        local::acceptor acceptor_;
+        RequestHandler &handler_;
+        std::shared_ptr<timers::TimeoutService> timeouts_;
+
+        void Accept () {
+            // each session on a strand: the timeout's close must not run next to a read or write of it
+            acceptor_.async_accept(net::make_strand(acceptor_.get_executor()),
+                                   [self = this->shared_from_this()](beast::error_code ec, local::socket socket) {
+                if (not ec) {
+                    auto strand = socket.get_executor();
+                    auto session = std::allocate_shared<Session>(memory::PoolAllocator<Session>{},
+                                                                 std::move(socket), self->handler_, self->timeouts_);
+                    net::dispatch(strand, [session = std::move(session)] { session->Read(); });
+                }
+                if (self->acceptor_.is_open()) self->Accept();
+            });
+        }
+    };
+
+}//!namespace
+
+#endif //GAME_SERVER_SHARD_ROUTER_H
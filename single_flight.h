@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#ifndef GAME_SERVER_SINGLE_FLIGHT_H
+#define GAME_SERVER_SINGLE_FLIGHT_H
+
+namespace coalescing {
+
+    // Runs at most one computation per key at a time.
+    // Callers arriving while it is in flight wait for it (at most max_wait) and share its result;
+    // an exception thrown by the computation is rethrown to every waiter.
+    // A waiter that runs out of max_wait gets null and never repeats the computation itself:
+    // a slow computation must not turn into one computation per waiter.
+    template <typename Key, typename Value, typename Hash = std::hash<Key>>
+    class SingleFlight final {
+    public:
+        using ValuePtr = std::shared_ptr<const Value>;
+
+        template <typename Fn>
+        ValuePtr Do (const Key &key, Fn &&fn, std::chrono::milliseconds max_wait);
+
+        size_t InFlight () const;
+
+    private:
+        mutable std::mutex mutex_;
+        std::unordered_map<Key, std::shared_future<ValuePtr>, Hash> in_flight_;
+    };
+
+    template <typename Key, typename Value, typename Hash>
+    template <typename Fn>
+    typename SingleFlight<Key, Value, Hash>::ValuePtr SingleFlight<Key, Value, Hash>::Do (
+            const Key &key,
+            Fn &&fn,
+            std::chrono::milliseconds max_wait) {
+        std::unique_lock lock(mutex_);
+        if (auto found = in_flight_.find(key); found != in_flight_.end()) {
+            auto result = found->second;
+            lock.unlock();
+            if (result.wait_for(max_wait) == std::future_status::ready) return result.get();
+            return nullptr;
+        }
+
+        std::promise<ValuePtr> promise;
+        in_flight_.emplace(key, promise.get_future().share());
+        lock.unlock();
+
+        ValuePtr value;
+        try {
+            value = std::make_shared<const Value>(fn());
+            promise.set_value(value);
+        }
+        catch (...) {
+            promise.set_exception(std::current_exception());
+            lock.lock();
+            in_flight_.erase(key);
+            throw;
+        }
+        lock.lock();
+        in_flight_.erase(key);
+        return value;
+    }
+
+    template <typename Key, typename Value, typename Hash>
+    size_t SingleFlight<Key, Value, Hash>::InFlight () const {
+        std::lock_guard lock(mutex_);
+        return in_flight_.size();
+    }
+
+}//!namespace
+
+#endif //GAME_SERVER_SINGLE_FLIGHT_H
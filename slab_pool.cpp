@@ -0,0 +1,143 @@
+#include "slab_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <mutex>
+#include <vector>
+
+namespace memory {
+
+    namespace {
+
+        // 16, 32, ... 64 KiB
+        constexpr size_t CLASS_COUNT = std::bit_width(const_values::MAX_BLOCK_SIZE) -
+                                       std::bit_width(const_values::MIN_BLOCK_SIZE) + 1;
+
+        struct FreeBlock {
+            FreeBlock *next;
+        };
+
+        struct FreeList {
+            FreeBlock *head {nullptr};
+            size_t count {0};
+
+            void Push (void *p) {
+                auto *block = static_cast<FreeBlock*>(p);
+                block->next = head;
+                head = block;
+                ++count;
+            }
+
+            void *Pop () {
+                FreeBlock *block = head;
+                head = block->next;
+                --count;
+                return block;
+            }
+        };
+
+        struct Depot {
+            std::mutex mutex;
+            std::array<FreeList, CLASS_COUNT> lists;
+            std::vector<void*> slabs;   // kept only to stay reachable
+        };
+
+        Depot &GetDepot () {
+            static Depot *depot = new Depot();  // outlives every thread cache
+            return *depot;
+        }
+
+        size_t ClassOf (size_t size) {
+            const size_t rounded = std::max(size, const_values::MIN_BLOCK_SIZE);
+            return std::bit_width(rounded - 1) - std::bit_width(const_values::MIN_BLOCK_SIZE - 1);
+        }
+
+        size_t BlockSize (size_t size_class) {
+            return const_values::MIN_BLOCK_SIZE << size_class;
+        }
+
+        size_t CacheLimit (size_t size_class) {
+            return std::max<size_t>(const_values::THREAD_CACHE_BYTES / BlockSize(size_class), 4u);
+        }
+
+        // set once the cache of the current thread is gone (late frees from other thread_local destructors)
+        thread_local bool thread_cache_destroyed {false};
+
+        struct ThreadCache {
+            std::array<FreeList, CLASS_COUNT> lists;
+
+            ~ThreadCache () {
+                thread_cache_destroyed = true;
+                auto &depot = GetDepot();
+                std::lock_guard lock(depot.mutex);
+                for (size_t size_class = 0; size_class < CLASS_COUNT; ++size_class) {
+                    while (lists[size_class].count != 0) depot.lists[size_class].Push(lists[size_class].Pop());
+                }
+            }
+
+            // Takes half a cache worth from the depot, carves a new slab if it is empty
+            void Refill (size_t size_class) {
+                auto &list = lists[size_class];
+                const size_t wanted = std::max<size_t>(CacheLimit(size_class) / 2, 1u);
+                auto &depot = GetDepot();
+                std::lock_guard lock(depot.mutex);
+                auto &shared = depot.lists[size_class];
+                while (shared.count != 0 && list.count < wanted) list.Push(shared.Pop());
+                if (list.count != 0) return;
+
+                const size_t block_size = BlockSize(size_class);
+                const size_t slab_size = std::max(const_values::SLAB_SIZE, block_size * 4u);
+                auto *slab = static_cast<char*>(::operator new(slab_size, std::align_val_t{const_values::BLOCK_ALIGNMENT}));
+                depot.slabs.push_back(slab);
+                for (size_t offset = 0; offset + block_size <= slab_size; offset += block_size) {
+                    list.Push(slab + offset);
+                }
+            }
+
+            // Gives half of an overgrown cache back, so memory freed here can serve other threads
+            void Trim (size_t size_class) {
+                auto &list = lists[size_class];
+                auto &depot = GetDepot();
+                std::lock_guard lock(depot.mutex);
+                const size_t keep = CacheLimit(size_class) / 2;
+                while (list.count > keep) depot.lists[size_class].Push(list.Pop());
+            }
+        };
+
+        thread_local ThreadCache thread_cache;
+
+    }//!namespace
+
+    void *Allocate (size_t size) {
+        if (size > const_values::MAX_BLOCK_SIZE) {
+            return ::operator new(size, std::align_val_t{const_values::BLOCK_ALIGNMENT});
+        }
+        const size_t size_class = ClassOf(size);
+        if (thread_cache_destroyed) {
+            return ::operator new(BlockSize(size_class), std::align_val_t{const_values::BLOCK_ALIGNMENT});
+        }
+        auto &list = thread_cache.lists[size_class];
+        if (list.count == 0) thread_cache.Refill(size_class);
+        return list.Pop();
+    }
+
+    void Deallocate (void *p, size_t size) noexcept {
+        if (not p) return;
+        if (size > const_values::MAX_BLOCK_SIZE) {
+            ::operator delete(p, std::align_val_t{const_values::BLOCK_ALIGNMENT});
+            return;
+        }
+        const size_t size_class = ClassOf(size);
+        if (thread_cache_destroyed) {
+            auto &depot = GetDepot();
+            std::lock_guard lock(depot.mutex);
+            depot.lists[size_class].Push(p);
+            return;
+        }
+        auto &list = thread_cache.lists[size_class];
+        list.Push(p);
+        if (list.count > CacheLimit(size_class)) thread_cache.Trim(size_class);
+    }
+
+}//!namespace
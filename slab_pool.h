@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+#ifndef GAME_SERVER_SLAB_POOL_H
+#define GAME_SERVER_SLAB_POOL_H
+
+namespace memory {
+
+    namespace const_values {
+        static const size_t MIN_BLOCK_SIZE {16u};
+        static const size_t MAX_BLOCK_SIZE {64u * 1024u};      // bigger requests go to the global heap
+        static const size_t BLOCK_ALIGNMENT {16u};
+        static const size_t SLAB_SIZE {256u * 1024u};
+        static const size_t THREAD_CACHE_BYTES {1024u * 1024u}; // per size class, the rest goes back to the depot
+    }
+
+    // Size-class slabs with a per-thread free list in front of a shared depot.
+    // Blocks may be freed on any thread; slabs are never given back to the system.
+    void *Allocate (size_t size);
+    void Deallocate (void *p, size_t size) noexcept;
+
+    // Stateless allocator over the slabs: session objects, their buffers and header
+    // fields freed by one connection are picked up by the next one on the same thread
+    template <typename T>
+    class PoolAllocator {
+    public:
+        using value_type = T;
+        using is_always_equal = std::true_type;
+
+        static_assert(alignof(T) <= const_values::BLOCK_ALIGNMENT, "over-aligned type for PoolAllocator");
+
+        PoolAllocator () noexcept = default;
+        template <typename U>
+        PoolAllocator (const PoolAllocator<U>&) noexcept {}
+
+        T *allocate (size_t n) {
+            return static_cast<T*>(Allocate(n * sizeof(T)));
+        }
+
+        void deallocate (T *p, size_t n) noexcept {
+            Deallocate(p, n * sizeof(T));
+        }
+
+        template <typename U>
+        bool operator== (const PoolAllocator<U>&) const noexcept { return true; }
+        template <typename U>
+        bool operator!= (const PoolAllocator<U>&) const noexcept { return false; }
+    };
+
+}//!namespace
+
+#endif //GAME_SERVER_SLAB_POOL_H
@@ -0,0 +1,75 @@
+// g++ -std=c++20 -I.. hot_files_tests.cpp ../hot_files.cpp ../io_backend.cpp -pthread
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include "../hot_files.h"
+
+#include <fstream>
+#include <random>
+
+namespace {
+
+    using io::const_values::HOT_FILE_CANDIDATES_MAX_COUNT;
+    using io::const_values::HOT_FILE_HITS;
+
+    struct Dir {
+        io::fs::path path {io::fs::temp_directory_path() / ("hot_files_tests_" + std::to_string(std::random_device{}()))};
+
+        Dir () { io::fs::create_directories(path); }
+        ~Dir () { io::fs::remove_all(path); }
+
+        io::fs::path File (const std::string &name, const std::string &content) const {
+            std::ofstream(path / name) << content;
+            return path / name;
+        }
+    };
+
+    io::HotFiles MakeHotFiles () {
+        return io::HotFiles(std::make_unique<io::PreadFileReader>());
+    }
+
+}//!namespace
+
+TEST_CASE("Files are cached once they are hot") {
+    Dir dir;
+    const auto path = dir.File("app.js", "console.log(1)");
+    auto hot_files = MakeHotFiles();
+
+    for (size_t hit = 1; hit < HOT_FILE_HITS; ++hit) hot_files.Touch(path);
+    hot_files.WaitLoaded();
+    CHECK(hot_files.Find(path) == nullptr);
+
+    hot_files.Touch(path);
+    hot_files.WaitLoaded();
+    const auto cached = hot_files.Find(path);
+    REQUIRE(cached != nullptr);
+    CHECK(*cached == "console.log(1)");
+}
+
+TEST_CASE("Files too big for the cache stay on disk") {
+    Dir dir;
+    const auto path = dir.File("big.bin", std::string(io::const_values::HOT_FILE_MAX_SIZE + 1, 'x'));
+    auto hot_files = MakeHotFiles();
+    for (size_t hit = 0; hit < HOT_FILE_HITS; ++hit) hot_files.Touch(path);
+    hot_files.WaitLoaded();
+    CHECK(hot_files.Find(path) == nullptr);
+}
+
+TEST_CASE("A scan of cold paths doesn't keep a hot file out") {
+    Dir dir;
+    const auto hot = dir.File("index.html", "<html></html>");
+    auto hot_files = MakeHotFiles();
+
+    // between every two hits on the hot file, half the candidate table worth of paths seen once
+    size_t cold = 0;
+    for (size_t hit = 0; hit < HOT_FILE_HITS; hit += 2) {
+        hot_files.Touch(hot);
+        hot_files.Touch(hot);
+        for (size_t i = 0; i < HOT_FILE_CANDIDATES_MAX_COUNT / 2; ++i) {
+            hot_files.Touch(dir.path / ("missing" + std::to_string(cold++)));
+        }
+    }
+    REQUIRE(cold > HOT_FILE_CANDIDATES_MAX_COUNT);
+    hot_files.WaitLoaded();
+    CHECK(hot_files.Find(hot) != nullptr);
+}
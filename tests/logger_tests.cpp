@@ -0,0 +1,153 @@
+// g++ -std=c++20 -I.. logger_tests.cpp ../logger.cpp -pthread
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include "../logger.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace std::string_view_literals;
+using namespace std::chrono_literals;
+
+namespace {
+
+    // The logger is a process-wide singleton: every test writes into its own temporary file
+    struct Capture {
+        std::FILE *file {std::tmpfile()};
+
+        Capture () {
+            logging::Logger::Instance().SetLevel(logging::Level::Info);
+            logging::Logger::Instance().SetOutput(file);
+        }
+        ~Capture () {
+            logging::Logger::Instance().Flush();
+            logging::Logger::Instance().SetOutput(stderr);
+            std::fclose(file);
+        }
+
+        // What the writer has written so far, without flushing the logger. Read through the descriptor:
+        // moving the FILE position under the writer would make it write over earlier lines
+        std::string Written () const {
+            std::string content;
+            char buffer[4096];
+            for (ssize_t read; (read = ::pread(::fileno(file), buffer, sizeof(buffer), content.size())) > 0;) {
+                content.append(buffer, static_cast<size_t>(read));
+            }
+            return content;
+        }
+
+        size_t Lines () const {
+            const auto content = Written();
+            return static_cast<size_t>(std::count(content.begin(), content.end(), '\n'));
+        }
+
+        // Waits for the writer to get to `lines` on its own
+        bool WaitLines (size_t lines, std::chrono::milliseconds timeout) const {
+            const auto deadline = std::chrono::steady_clock::now() + timeout;
+            while (Lines() < lines) {
+                if (std::chrono::steady_clock::now() > deadline) return false;
+                std::this_thread::sleep_for(100us);
+            }
+            return true;
+        }
+    };
+
+}//!namespace
+
+TEST_CASE("Records are written as JSON lines") {
+    Capture capture;
+    logging::Log(logging::Level::Info, "server started"sv,
+                 logging::Kv("port"sv, 8080),
+                 logging::Kv("address"sv, "0.0.0.0"sv),
+                 logging::Kv("quote"sv, std::string("a\"b\n")));
+    logging::Log(logging::Level::Debug, "filtered out"sv);
+    logging::Logger::Instance().Flush();
+
+    const auto written = capture.Written();
+    CHECK(written.starts_with(R"({"timestamp":")"));
+    CHECK(written.find(R"("level":"info","message":"server started","port":8080,"address":"0.0.0.0","quote":"a\"b\n"})"
+                       "\n") != std::string::npos);
+    CHECK(written.find("filtered out") == std::string::npos);
+    CHECK(capture.Lines() == 1u);
+}
+
+TEST_CASE("Access records") {
+    Capture capture;
+    logging::AccessRecord record;
+    record.SetMethod("GET");
+    record.SetRoute(std::string(300, 'r'));     // truncated to the record's buffer
+    record.status = 200;
+    record.bytes = 512;
+    record.duration = 1500us;
+    logging::LogAccess(record);
+    logging::Logger::Instance().Flush();
+
+    const auto written = capture.Written();
+    CHECK(written.find(R"("message":"access","method":"GET","route":")" +
+                       std::string(logging::AccessRecord::ROUTE_SIZE - 1, 'r') +
+                       R"(","status":200,"bytes":512,"duration_us":1500})") != std::string::npos);
+}
+
+TEST_CASE("Records of finished threads are written") {
+    Capture capture;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < 100; ++i) logging::Log(logging::Level::Info, "from thread"sv, logging::Kv("t"sv, t));
+        });
+    }
+    for (auto &thread : threads) thread.join();
+    logging::Logger::Instance().Flush();
+    CHECK(capture.Lines() == 800u);
+}
+
+TEST_CASE("A full ring drops records and reports how many") {
+    Capture capture;
+    const auto dropped_before = logging::Logger::Instance().DroppedCount();
+    const size_t burst = logging::const_values::RING_CAPACITY * 4;
+    for (size_t i = 0; i < burst; ++i) logging::Log(logging::Level::Info, "burst"sv);
+    logging::Logger::Instance().Flush();
+
+    const auto dropped = logging::Logger::Instance().DroppedCount() - dropped_before;
+    const auto written = capture.Written();
+    size_t kept = 0;
+    for (size_t pos = 0; (pos = written.find(R"("message":"burst")", pos)) != std::string::npos; ++pos) ++kept;
+    CHECK(kept + dropped == burst);
+    if (dropped != 0) CHECK(written.find("log records dropped") != std::string::npos);
+}
+
+TEST_CASE("The writer wakes up for every record without a flush") {
+    Capture capture;
+    // The writer is still formatting the first record when the second push reads the ring's head,
+    // and the second record is moved into its slot slowly: the ring looked non-empty, meanwhile the
+    // writer finished, found nothing and went to sleep.
+    struct SlowMove {
+        SlowMove () = default;
+        SlowMove (SlowMove&&) noexcept { std::this_thread::sleep_for(50ms); }
+    };
+    const int rounds = 20;
+    size_t expected = 0;
+    int stuck = 0;
+    for (int round = 0; round < rounds; ++round) {
+        std::thread([] {
+            logging::Logger::Instance().Push([](std::string &out) {
+                std::this_thread::sleep_for(20ms);
+                out += "first\n";
+            });
+            logging::Logger::Instance().Push([slow = SlowMove {}](std::string &out) {
+                out += "second\n";
+            });
+        }).join();
+        expected += 2;
+        if (not capture.WaitLines(expected, 1s)) {
+            ++stuck;
+            logging::Logger::Instance().Flush();    // the next round starts from a written file
+        }
+    }
+    CHECK(stuck == 0);
+}
@@ -0,0 +1,51 @@
+// g++ -std=c++20 -I.. map_batch_tests.cpp ../map_batch.cpp
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include "../map_batch.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+    map_batch::FragmentsById TestMaps () {
+        return {
+                {"map1"s, {{"id"s, R"("id":"map1")"s},
+                           {"name"s, R"("name":"Map 1")"s},
+                           {"roads"s, R"("roads":[{"x0":0,"y0":0,"x1":40}])"s}}},
+                {"town"s, {{"id"s, R"("id":"town")"s},
+                           {"name"s, R"("name":"Town")"s},
+                           {"roads"s, R"("roads":[])"s}}},
+        };
+    }
+
+}//!namespace
+
+TEST_CASE("Batch keeps the requested order and all fields by default") {
+    const auto maps = TestMaps();
+    CHECK(map_batch::Assemble(maps, {"town", "map1"}, {}) ==
+          R"([{"id":"town","name":"Town","roads":[]},{"id":"map1","name":"Map 1","roads":[{"x0":0,"y0":0,"x1":40}]}])"s);
+    CHECK(map_batch::Assemble(maps, {"map1"}, {}) ==
+          R"([{"id":"map1","name":"Map 1","roads":[{"x0":0,"y0":0,"x1":40}]}])"s);
+}
+
+TEST_CASE("Batch projects fields in map order") {
+    const auto maps = TestMaps();
+    // the order of fields in the request doesn't matter
+    CHECK(map_batch::Assemble(maps, {"map1", "town"}, {"name", "id"}) ==
+          R"([{"id":"map1","name":"Map 1"},{"id":"town","name":"Town"}])"s);
+    CHECK(map_batch::Assemble(maps, {"town"}, {"roads"}) == R"([{"roads":[]}])"s);
+    // unknown fields are ignored, nothing left gives empty objects
+    CHECK(map_batch::Assemble(maps, {"town", "map1"}, {"lootTypes"}) == "[{},{}]"s);
+}
+
+TEST_CASE("Batch with an unknown map fails as a whole") {
+    const auto maps = TestMaps();
+    CHECK_FALSE(map_batch::Assemble(maps, {"map1", "nowhere"}, {}));
+    CHECK_FALSE(map_batch::Assemble({}, {"map1"}, {}));
+}
+
+TEST_CASE("Batch repeats duplicated ids") {
+    const auto maps = TestMaps();
+    CHECK(map_batch::Assemble(maps, {"town", "town"}, {"id"}) == R"([{"id":"town"},{"id":"town"}])"s);
+}
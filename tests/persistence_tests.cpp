@@ -0,0 +1,281 @@
+// g++ -std=c++20 -I.. persistence_tests.cpp ../persistence.cpp -pthread
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include "../persistence.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <sys/resource.h>
+
+using namespace persistence;
+
+namespace {
+
+    struct TempDir {
+        fs::path path;
+
+        TempDir () {
+            std::random_device rd;
+            path = fs::temp_directory_path() / ("persistence_tests_" + std::to_string(rd()));
+            fs::create_directories(path);
+        }
+        ~TempDir () {
+            std::error_code ec;
+            fs::remove_all(path, ec);
+        }
+    };
+
+    std::vector<Record> ReplayAll (const fs::path &dir, Lsn after = 0) {
+        std::vector<Record> records;
+        WriteAheadLog::Replay(dir, after, [&records](const Record &record) { records.push_back(record); });
+        return records;
+    }
+
+    std::vector<fs::path> Segments (const fs::path &dir) {
+        std::vector<fs::path> segments;
+        for (const auto &entry : fs::directory_iterator(dir)) {
+            if (entry.path().filename().string().starts_with(const_values::WAL_PREFIX)) segments.push_back(entry.path());
+        }
+        std::sort(segments.begin(), segments.end());
+        return segments;
+    }
+
+    // Every record appends its payload, the whole history is easy to compare
+    struct Journal {
+        std::vector<std::string> entries;
+        Lsn last_lsn {0};       // not serialized, only what was applied since the start
+
+        void Apply (const Record &record) {
+            entries.push_back(record.payload);
+            last_lsn = record.lsn;
+        }
+        std::string Serialize () const {
+            std::string out;
+            for (const auto &entry : entries) {
+                out += entry;
+                out += '\n';
+            }
+            return out;
+        }
+        static Journal Deserialize (std::string_view data) {
+            Journal journal;
+            while (not data.empty()) {
+                const auto pos = data.find('\n');
+                journal.entries.emplace_back(data.substr(0, pos));
+                data.remove_prefix(pos + 1);
+            }
+            return journal;
+        }
+    };
+
+    const std::chrono::milliseconds NO_PERIODIC_SNAPSHOTS {std::chrono::hours(1)};
+
+}//!namespace
+
+TEST_CASE("WAL replays records in order after restart") {
+    TempDir dir;
+    {
+        WriteAheadLog wal(dir.path, 1);
+        for (int i = 0; i < 100; ++i) wal.Append(static_cast<RecordType>(i % 3), "record " + std::to_string(i));
+        wal.WaitDurable(100);
+    }
+    const auto records = ReplayAll(dir.path);
+    REQUIRE(records.size() == 100u);
+    for (size_t i = 0; i < records.size(); ++i) {
+        CHECK(records[i].lsn == i + 1);
+        CHECK(records[i].type == i % 3);
+        CHECK(records[i].payload == "record " + std::to_string(i));
+    }
+    CHECK(ReplayAll(dir.path, 90).size() == 10u);
+}
+
+TEST_CASE("WAL replay stops at a torn tail") {
+    TempDir dir;
+    {
+        WriteAheadLog wal(dir.path, 1);
+        for (int i = 0; i < 10; ++i) wal.Append(0, std::string(32, 'a' + i));
+        wal.WaitDurable(10);
+    }
+    const auto segment = Segments(dir.path).front();
+
+    SECTION("cut in the middle of the last record") {
+        fs::resize_file(segment, fs::file_size(segment) - 5);
+        const auto records = ReplayAll(dir.path);
+        REQUIRE(records.size() == 9u);
+        CHECK(records.back().lsn == 9u);
+    }
+    SECTION("garbage in the last record") {
+        {
+            std::fstream file(segment, std::ios::in | std::ios::out | std::ios::binary);
+            file.seekp(-3, std::ios::end);
+            file.write("xyz", 3);
+        }
+        CHECK(ReplayAll(dir.path).size() == 9u);
+    }
+    SECTION("a new log continues after the last intact record") {
+        fs::resize_file(segment, fs::file_size(segment) - 5);
+        const Lsn last = WriteAheadLog::Replay(dir.path, 0, [](const Record&) {});
+        REQUIRE(last == 9u);
+        {
+            WriteAheadLog wal(dir.path, last + 1);
+            wal.WaitDurable(wal.Append(0, "after crash"));
+        }
+        const auto records = ReplayAll(dir.path);
+        REQUIRE(records.size() == 10u);
+        CHECK(records.back().lsn == 10u);
+        CHECK(records.back().payload == "after crash");
+    }
+}
+
+TEST_CASE("WAL rotation and segment dropping") {
+    TempDir dir;
+    WriteAheadLog wal(dir.path, 1);
+    for (int i = 0; i < 3; ++i) wal.Append(0, "old");
+    CHECK(wal.Rotate() == 4u);
+    CHECK(wal.Rotate() == 4u);      // nothing new since the previous rotation
+    for (int i = 0; i < 2; ++i) wal.Append(0, "new");
+    wal.WaitDurable(5);
+
+    REQUIRE(Segments(dir.path).size() == 2u);
+    CHECK(ReplayAll(dir.path).size() == 5u);
+
+    wal.DropSegmentsUpTo(2);        // the first segment still holds lsn 3
+    CHECK(Segments(dir.path).size() == 2u);
+
+    wal.DropSegmentsUpTo(3);
+    REQUIRE(Segments(dir.path).size() == 1u);
+    const auto records = ReplayAll(dir.path);
+    REQUIRE(records.size() == 2u);
+    CHECK(records.front().lsn == 4u);
+
+    wal.DropSegmentsUpTo(100);      // the current segment is never dropped
+    CHECK(Segments(dir.path).size() == 1u);
+}
+
+TEST_CASE("WAL reports write failures to waiters") {
+    TempDir dir;
+    rlimit old_limit {};
+    REQUIRE(::getrlimit(RLIMIT_FSIZE, &old_limit) == 0);
+    const auto old_handler = ::signal(SIGXFSZ, SIG_IGN);
+
+    WriteAheadLog wal(dir.path, 1);
+    wal.WaitDurable(wal.Append(0, "fits"));
+
+    rlimit limit = old_limit;
+    limit.rlim_cur = 64;            // the next batch gets EFBIG, like a full disk would
+    REQUIRE(::setrlimit(RLIMIT_FSIZE, &limit) == 0);
+    const Lsn lsn = wal.Append(0, std::string(1024, 'x'));
+    CHECK_THROWS_AS(wal.WaitDurable(lsn), std::system_error);
+    CHECK_THROWS_AS(wal.Append(0, "after failure"), std::system_error);
+    CHECK_NOTHROW(wal.WaitDurable(1));  // was durable before the failure
+
+    ::setrlimit(RLIMIT_FSIZE, &old_limit);
+    ::signal(SIGXFSZ, old_handler);
+}
+
+TEST_CASE("Persister recovers from snapshot plus WAL") {
+    TempDir dir;
+    {
+        Persister<Journal> persister(dir.path, NO_PERIODIC_SNAPSHOTS);
+        for (int i = 0; i < 10; ++i) persister.Mutate(0, "before " + std::to_string(i));
+        persister.SnapshotNow();
+        Lsn lsn = 0;
+        for (int i = 0; i < 5; ++i) lsn = persister.Mutate(0, "after " + std::to_string(i));
+        persister.WaitDurable(lsn);
+    }
+    // the snapshot covers the first segment, it is gone
+    CHECK(Segments(dir.path).size() == 1u);
+
+    Persister<Journal> recovered(dir.path, NO_PERIODIC_SNAPSHOTS);
+    const auto entries = recovered.Read([](const Journal &journal) { return journal.entries; });
+    REQUIRE(entries.size() == 15u);
+    CHECK(entries.front() == "before 0");
+    CHECK(entries[9] == "before 9");
+    CHECK(entries.back() == "after 4");
+    // numbering goes on where it stopped
+    CHECK(recovered.Mutate(0, "next") == 16u);
+}
+
+TEST_CASE("Persister snapshots don't lose concurrent mutations") {
+    TempDir dir;
+    const int writers = 4;
+    const int per_writer = 2000;
+    {
+        Persister<Journal> persister(dir.path, NO_PERIODIC_SNAPSHOTS);
+        std::atomic<bool> done {false};
+        std::atomic<int> shrunk_reads {0};     // Catch assertions are main thread only
+        std::thread snapshotter([&] {
+            size_t seen = 0;
+            while (not done) {
+                persister.SnapshotNow();
+                const size_t size = persister.Read([](const Journal &journal) { return journal.entries.size(); });
+                if (size < seen) ++shrunk_reads;
+                seen = size;
+            }
+        });
+        std::vector<std::thread> threads;
+        for (int w = 0; w < writers; ++w) {
+            threads.emplace_back([&persister, w] {
+                Lsn lsn = 0;
+                for (int i = 0; i < per_writer; ++i) lsn = persister.Mutate(0, std::to_string(w) + ':' + std::to_string(i));
+                persister.WaitDurable(lsn);
+            });
+        }
+        for (auto &thread : threads) thread.join();
+        done = true;
+        snapshotter.join();
+        CHECK(shrunk_reads == 0);
+        CHECK(persister.Read([](const Journal &journal) { return journal.entries.size(); }) ==
+              static_cast<size_t>(writers * per_writer));
+        // the snapshot holds what the live state holds
+        persister.SnapshotNow();
+        CHECK(SnapshotFile(dir.path).Load()->second ==
+              persister.Read([](const Journal &journal) { return journal.Serialize(); }));
+    }
+    Persister<Journal> recovered(dir.path, NO_PERIODIC_SNAPSHOTS);
+    const auto entries = recovered.Read([](const Journal &journal) { return journal.entries; });
+    REQUIRE(entries.size() == static_cast<size_t>(writers * per_writer));
+    // per writer, mutations come back in the order they were made
+    std::vector<int> next(writers, 0);
+    for (const auto &entry : entries) {
+        const int w = std::stoi(entry.substr(0, entry.find(':')));
+        CHECK(std::stoi(entry.substr(entry.find(':') + 1)) == next[w]++);
+    }
+}
+
+TEST_CASE("Persister applies records with the lsn they were logged under") {
+    TempDir dir;
+    Persister<Journal> persister(dir.path, NO_PERIODIC_SNAPSHOTS);
+    for (int i = 0; i < 3; ++i) {
+        const Lsn lsn = persister.Mutate(0, "entry");
+        CHECK(persister.Read([](const Journal &journal) { return journal.last_lsn; }) == lsn);
+    }
+}
+
+TEST_CASE("Persister leaves the state alone when the WAL refuses a mutation") {
+    TempDir dir;
+    rlimit old_limit {};
+    REQUIRE(::getrlimit(RLIMIT_FSIZE, &old_limit) == 0);
+    const auto old_handler = ::signal(SIGXFSZ, SIG_IGN);
+    {
+        Persister<Journal> persister(dir.path, NO_PERIODIC_SNAPSHOTS);
+        persister.WaitDurable(persister.Mutate(0, "fits"));
+
+        rlimit limit = old_limit;
+        limit.rlim_cur = 64;
+        REQUIRE(::setrlimit(RLIMIT_FSIZE, &limit) == 0);
+        CHECK_THROWS_AS(persister.WaitDurable(persister.Mutate(0, std::string(1024, 'x'))), std::system_error);
+        const auto size = persister.Read([](const Journal &journal) { return journal.entries.size(); });
+        CHECK_THROWS_AS(persister.Mutate(0, "refused"), std::system_error);
+        CHECK(persister.Read([](const Journal &journal) { return journal.entries.size(); }) == size);
+        ::setrlimit(RLIMIT_FSIZE, &old_limit);
+    }
+    ::signal(SIGXFSZ, old_handler);
+}
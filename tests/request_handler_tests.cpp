@@ -0,0 +1,79 @@
+// g++ -std=c++20 -I.. request_handler_tests.cpp ../request_handler.cpp ../workers.cpp ../uri.cpp ../model.cpp ../json_handler.cpp ../utils.cpp ../hot_files.cpp ../io_backend.cpp ../map_batch.cpp ../debug_profiler.cpp ../logger.cpp ../shard_router.cpp ../slab_pool.cpp -pthread
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include "../request_handler.h"
+
+#include <atomic>
+#include <fstream>
+#include <random>
+#include <thread>
+
+namespace {
+
+    namespace fs = std::filesystem;
+    namespace http = boost::beast::http;
+
+    struct Answer {
+        unsigned status {0};
+        size_t bytes {0};
+    };
+
+    struct Root {
+        fs::path path {fs::temp_directory_path() / ("request_handler_tests_" + std::to_string(std::random_device{}()))};
+
+        Root () {
+            logging::Logger::Instance().SetLevel(logging::Level::Error);     // no access records
+            fs::create_directories(path);
+            std::ofstream(path / "index.html") << "<html></html>";
+        }
+        ~Root () { fs::remove_all(path); }
+    };
+
+    Answer Get (http_handler::RequestHandler &handler, std::string_view target) {
+        http::request<http::string_body> req {http::verb::get, target, 11};
+        Answer answer;
+        handler(std::move(req), [&answer](http_handler::resources::WorkerResponse &&res_holder) {
+            std::visit([&answer](const auto &res) {
+                if constexpr (not std::is_same_v<std::decay_t<decltype(res)>, types::response::None>) {
+                    answer.status = res.result_int();
+                    answer.bytes = res.payload_size().value_or(0u);
+                }
+            }, res_holder.GetValue());
+        });
+        return answer;
+    }
+
+}//!namespace
+
+TEST_CASE("Files requested through the file endpoint are served") {
+    Root root;
+    model::Game game;
+    http_handler::RequestHandler handler(game, fs::path(root.path));
+
+    const auto file = Get(handler, "/file?/index.html");
+    CHECK(file.status == 200u);
+    CHECK(file.bytes == std::string_view("<html></html>").size());
+    CHECK(Get(handler, "/file?/missing.html").status == 404u);
+    CHECK(Get(handler, "/index.html").status == 200u);
+}
+
+TEST_CASE("Concurrent requests for the same file are each served") {
+    Root root;
+    model::Game game;
+    http_handler::RequestHandler handler(game, fs::path(root.path));
+
+    const int threads = 4;
+    const int requests = 200;
+    std::atomic<int> served {0};
+    std::vector<std::thread> clients;
+    for (int t = 0; t < threads; ++t) {
+        clients.emplace_back([&] {
+            for (int i = 0; i < requests; ++i) {
+                if (Get(handler, "/file?/index.html").status == 200u) ++served;
+            }
+        });
+    }
+    for (auto &client : clients) client.join();
+    CHECK(served == threads * requests);
+}
@@ -0,0 +1,128 @@
+// g++ -std=c++20 -I.. single_flight_tests.cpp -pthread
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include "../single_flight.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+    using Flight = coalescing::SingleFlight<std::string, std::string>;
+
+    // Starts the leader and waits until its computation is running
+    template <typename Fn>
+    std::thread StartLeader (Flight &flight, const std::string &key, Fn fn, std::atomic<bool> &started) {
+        std::thread leader([&flight, key, fn, &started] {
+            flight.Do(key, [&] {
+                started = true;
+                return fn();
+            }, 0ms);
+        });
+        while (not started) std::this_thread::yield();
+        return leader;
+    }
+
+}//!namespace
+
+TEST_CASE("Concurrent callers share one computation") {
+    Flight flight;
+    std::atomic<int> calls {0};
+    std::atomic<bool> started {false};
+    std::atomic<bool> release {false};
+    auto leader = StartLeader(flight, "key", [&] {
+        ++calls;
+        while (not release) std::this_thread::yield();
+        return std::string("value");
+    }, started);
+
+    std::vector<std::thread> waiters;
+    std::atomic<int> shared {0};
+    for (int i = 0; i < 8; ++i) {
+        waiters.emplace_back([&] {
+            const auto value = flight.Do("key", [&] {
+                ++calls;
+                return std::string("other");
+            }, 10s);
+            if (value && *value == "value") ++shared;
+        });
+    }
+    std::this_thread::sleep_for(100ms);   // lets the waiters join the flight
+    release = true;
+    leader.join();
+    for (auto &waiter : waiters) waiter.join();
+
+    CHECK(calls == 1);
+    CHECK(shared == 8);
+    CHECK(flight.InFlight() == 0u);
+}
+
+TEST_CASE("Late waiters give up without repeating the computation") {
+    Flight flight;
+    std::atomic<int> calls {0};
+    std::atomic<bool> started {false};
+    std::atomic<bool> release {false};
+    auto leader = StartLeader(flight, "slow", [&] {
+        ++calls;
+        while (not release) std::this_thread::yield();
+        return std::string("value");
+    }, started);
+
+    const auto value = flight.Do("slow", [&] {
+        ++calls;
+        return std::string("again");
+    }, 10ms);
+    CHECK(value == nullptr);
+    CHECK(calls == 1);
+
+    release = true;
+    leader.join();
+    CHECK(flight.InFlight() == 0u);
+}
+
+TEST_CASE("Errors reach every waiter and don't stick") {
+    Flight flight;
+    std::atomic<bool> started {false};
+    std::atomic<bool> release {false};
+    std::atomic<int> errors {0};
+    // Catch assertions are main thread only, the threads just count
+    const auto count_error = [&errors](auto &&call) {
+        try {
+            call();
+        }
+        catch (const std::runtime_error&) {
+            ++errors;
+        }
+    };
+    std::thread leader([&] {
+        count_error([&] {
+            flight.Do("key", [&]() -> std::string {
+                started = true;
+                while (not release) std::this_thread::yield();
+                throw std::runtime_error("failed");
+            }, 0ms);
+        });
+    });
+    while (not started) std::this_thread::yield();
+    std::thread waiter([&] {
+        count_error([&] {
+            flight.Do("key", [] { return std::string("unused"); }, 10s);
+        });
+    });
+    std::this_thread::sleep_for(100ms);   // lets the waiters join the flight
+    release = true;
+    leader.join();
+    waiter.join();
+    CHECK(errors == 2);
+
+    // the next call computes afresh
+    const auto value = flight.Do("key", [] { return std::string("ok"); }, 10s);
+    REQUIRE(value);
+    CHECK(*value == "ok");
+}
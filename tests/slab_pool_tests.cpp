@@ -0,0 +1,154 @@
+// g++ -std=c++20 -I.. slab_pool_tests.cpp ../slab_pool.cpp -pthread
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include "../slab_pool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    using memory::const_values::BLOCK_ALIGNMENT;
+    using memory::const_values::MAX_BLOCK_SIZE;
+    using memory::const_values::MIN_BLOCK_SIZE;
+
+    bool IsAligned (const void *p) {
+        return reinterpret_cast<std::uintptr_t>(p) % BLOCK_ALIGNMENT == 0;
+    }
+
+    // A block just freed is the next one handed out for its size class, and only for it
+    bool SameClass (size_t freed_size, size_t next_size) {
+        void *p = memory::Allocate(freed_size);
+        memory::Deallocate(p, freed_size);
+        void *q = memory::Allocate(next_size);
+        memory::Deallocate(q, next_size);
+        return p == q;
+    }
+
+}//!namespace
+
+TEST_CASE("Sizes round up to power of two classes") {
+    CHECK(SameClass(0u, MIN_BLOCK_SIZE));
+    CHECK(SameClass(1u, MIN_BLOCK_SIZE));
+    CHECK_FALSE(SameClass(MIN_BLOCK_SIZE, MIN_BLOCK_SIZE + 1));
+    CHECK(SameClass(MIN_BLOCK_SIZE + 1, 2 * MIN_BLOCK_SIZE));
+    CHECK(SameClass(24u, 32u));
+    CHECK_FALSE(SameClass(32u, 33u));
+    CHECK(SameClass(1000u, 1024u));
+    CHECK_FALSE(SameClass(1024u, 1025u));
+    CHECK(SameClass(MAX_BLOCK_SIZE / 2 + 1, MAX_BLOCK_SIZE));
+}
+
+TEST_CASE("Blocks are aligned and don't overlap") {
+    std::vector<std::pair<unsigned char*, size_t>> blocks;
+    for (size_t size = 1; size <= MAX_BLOCK_SIZE * 2; size = size * 3 / 2 + 1) {
+        for (int i = 0; i < 8; ++i) {
+            auto *p = static_cast<unsigned char*>(memory::Allocate(size));
+            CHECK(IsAligned(p));
+            std::memset(p, static_cast<int>(blocks.size() % 251), size);
+            blocks.emplace_back(p, size);
+        }
+    }
+    size_t damaged = 0;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        const auto [p, size] = blocks[i];
+        for (size_t byte = 0; byte < size; ++byte) {
+            if (p[byte] != i % 251) {
+                ++damaged;
+                break;
+            }
+        }
+        memory::Deallocate(p, size);
+    }
+    CHECK(damaged == 0u);
+}
+
+TEST_CASE("Sizes past the largest class are served aligned from the heap") {
+    for (const size_t size : {MAX_BLOCK_SIZE + 1, 4 * MAX_BLOCK_SIZE, 64 * MAX_BLOCK_SIZE}) {
+        auto *p = static_cast<unsigned char*>(memory::Allocate(size));
+        CHECK(IsAligned(p));
+        std::memset(p, 1, size);
+        CHECK(p[size - 1] == 1);
+        memory::Deallocate(p, size);
+    }
+    memory::Deallocate(nullptr, MIN_BLOCK_SIZE);
+}
+
+TEST_CASE("Blocks freed on another thread are reused after it exits") {
+    // a size class nothing else in this test uses, so the depot holds only these blocks
+    const size_t size = 16u * 1024u;
+    const size_t count = 8u;
+    std::vector<void*> blocks;
+    for (size_t i = 0; i < count; ++i) blocks.push_back(memory::Allocate(size));
+    const std::set<void*> allocated(blocks.begin(), blocks.end());
+
+    std::thread([&] {
+        for (void *p : blocks) memory::Deallocate(p, size);
+    }).join();
+
+    // a fresh thread refills its cache from the depot before carving a new slab
+    void *reused = nullptr;
+    std::thread([&] {
+        reused = memory::Allocate(size);
+        memory::Deallocate(reused, size);
+    }).join();
+    CHECK(allocated.count(reused) == 1u);
+}
+
+TEST_CASE("Threads passing blocks to each other") {
+    const int threads = 4;
+    const int rounds = 20000;
+    std::mutex mutex;
+    std::vector<std::pair<unsigned char*, size_t>> exchange;
+    std::atomic<int> damaged {0};
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (int i = 0; i < rounds; ++i) {
+                const size_t size = 8u + (static_cast<size_t>(i * 37 + t) % 2048u);
+                auto *p = static_cast<unsigned char*>(memory::Allocate(size));
+                std::memset(p, static_cast<int>(size % 251), size);
+                std::pair<unsigned char*, size_t> taken {nullptr, 0u};
+                {
+                    std::lock_guard lock(mutex);
+                    exchange.emplace_back(p, size);
+                    if (exchange.size() > 64u) {
+                        taken = exchange.front();
+                        exchange.erase(exchange.begin());
+                    }
+                }
+                if (taken.first) {
+                    for (size_t byte = 0; byte < taken.second; ++byte) {
+                        if (taken.first[byte] != taken.second % 251) {
+                            ++damaged;
+                            break;
+                        }
+                    }
+                    memory::Deallocate(taken.first, taken.second);
+                }
+            }
+        });
+    }
+    for (auto &worker : workers) worker.join();
+    for (const auto &[p, size] : exchange) memory::Deallocate(p, size);
+    CHECK(damaged == 0);
+}
+
+TEST_CASE("PoolAllocator works with standard containers") {
+    std::vector<int, memory::PoolAllocator<int>> numbers;
+    for (int i = 0; i < 100000; ++i) numbers.push_back(i);     // grows past the largest class
+    CHECK(numbers[99999] == 99999);
+
+    auto shared = std::allocate_shared<std::string>(memory::PoolAllocator<std::string>{}, "pooled");
+    CHECK(*shared == "pooled");
+    CHECK(memory::PoolAllocator<int>{} == memory::PoolAllocator<char>{});
+}
@@ -0,0 +1,174 @@
+// g++ -std=c++20 -I.. timing_wheel_tests.cpp ../timing_wheel.cpp
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include "../timing_wheel.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+    using timers::TimingWheel;
+
+    const TimingWheel::Clock::time_point START {};
+    const TimingWheel::Clock::duration TICK {1ms};
+
+    // Advances to the given tick and runs what expired, returns how many did
+    size_t AdvanceTo (TimingWheel &wheel, std::uint64_t tick) {
+        std::vector<TimingWheel::Callback> expired;
+        wheel.Advance(START + tick * TICK, expired);
+        for (auto &callback : expired) callback();
+        return expired.size();
+    }
+
+    std::uint64_t Ticks (size_t level) {
+        return std::uint64_t{1} << (timers::const_values::WHEEL_SLOT_BITS * level);
+    }
+
+}//!namespace
+
+TEST_CASE("Timers fire on their tick, not earlier") {
+    TimingWheel wheel(TICK, START);
+    int fired = 0;
+    wheel.Schedule(5ms, [&] { ++fired; });
+    CHECK(AdvanceTo(wheel, 4) == 0u);
+    CHECK(AdvanceTo(wheel, 5) == 1u);
+    CHECK(fired == 1);
+    CHECK(wheel.Size() == 0u);
+
+    SECTION("partial ticks round up") {
+        wheel.Schedule(1500us, [&] { ++fired; });
+        CHECK(AdvanceTo(wheel, 6) == 0u);
+        CHECK(AdvanceTo(wheel, 7) == 1u);
+    }
+    SECTION("zero timeout waits one tick") {
+        wheel.Schedule(0ms, [&] { ++fired; });
+        CHECK(AdvanceTo(wheel, 5) == 0u);
+        CHECK(AdvanceTo(wheel, 6) == 1u);
+    }
+    SECTION("a jump runs everything passed over") {
+        for (int i = 1; i <= 10; ++i) wheel.Schedule(i * 100ms, [&] { ++fired; });
+        CHECK(AdvanceTo(wheel, 1005) == 10u);
+        CHECK(fired == 11);
+    }
+}
+
+TEST_CASE("Timers cascade down every level and fire exactly on time") {
+    TimingWheel wheel(TICK, START);
+    std::map<std::uint64_t, std::uint64_t> fired_at;    // expiry -> tick it fired on
+    std::uint64_t now = 0;
+    const auto schedule = [&](std::uint64_t ticks) {
+        const std::uint64_t expires = now + ticks;
+        wheel.Schedule(ticks * TICK, [&, expires] { fired_at[expires] = now; });
+        return expires;
+    };
+
+    // level boundaries, and timers scheduled off a slot boundary so cascading has to split them
+    std::vector<std::uint64_t> expiries;
+    for (size_t level = 1; level < timers::const_values::WHEEL_LEVELS; ++level) {
+        for (const std::uint64_t ticks : {Ticks(level) - 1, Ticks(level), Ticks(level) + 1}) {
+            expiries.push_back(schedule(ticks));
+        }
+    }
+    now = 77;
+    AdvanceTo(wheel, now);
+    for (const std::uint64_t ticks : {Ticks(1) - 70, Ticks(1) * 3 + 5, Ticks(2) - 1, Ticks(2) * 2 + Ticks(1) + 1}) {
+        expiries.push_back(schedule(ticks));
+    }
+    const std::uint64_t last = *std::max_element(expiries.begin(), expiries.end());
+    REQUIRE(wheel.Size() == expiries.size());
+
+    // tick by tick around each expiry, in jumps between them
+    std::sort(expiries.begin(), expiries.end());
+    for (const std::uint64_t expires : expiries) {
+        if (expires - 1 > now) AdvanceTo(wheel, now = expires - 1);
+        CHECK(fired_at.count(expires) == 0u);
+        AdvanceTo(wheel, now = expires);
+    }
+    CHECK(wheel.Size() == 0u);
+    REQUIRE(fired_at.size() == expiries.size());
+    for (const auto &[expires, tick] : fired_at) {
+        CAPTURE(expires);
+        CHECK(tick == expires);
+    }
+    CHECK(now == last);
+}
+
+TEST_CASE("Random timers across the lower levels fire on their tick") {
+    TimingWheel wheel(TICK, START);
+    std::mt19937 random(42);
+    std::uniform_int_distribution<std::uint64_t> ticks(1u, Ticks(2) * 3);
+    std::uint64_t now = 0;
+    size_t early_or_late = 0;
+    size_t fired = 0;
+    size_t scheduled = 0;
+    while (now < Ticks(2) * 4) {
+        if (now % 97 == 0) {
+            const std::uint64_t expires = now + ticks(random);
+            wheel.Schedule((expires - now) * TICK, [&, expires] {
+                ++fired;
+                if (now != expires) ++early_or_late;
+            });
+            ++scheduled;
+        }
+        AdvanceTo(wheel, ++now);
+    }
+    while (wheel.Size() != 0u) AdvanceTo(wheel, ++now);
+    CHECK(fired == scheduled);
+    CHECK(early_or_late == 0u);
+}
+
+TEST_CASE("Reschedule and cancel") {
+    TimingWheel wheel(TICK, START);
+    int fired = 0;
+    const auto id = wheel.Schedule(10ms, [&] { ++fired; });
+
+    SECTION("reschedule moves the timer both ways, across levels") {
+        CHECK(wheel.Reschedule(id, 1000ms));
+        CHECK(AdvanceTo(wheel, 999) == 0u);
+        CHECK(wheel.Reschedule(id, 3ms));
+        CHECK(AdvanceTo(wheel, 1001) == 0u);
+        CHECK(AdvanceTo(wheel, 1002) == 1u);
+        CHECK(fired == 1);
+    }
+    SECTION("cancelled timers don't fire") {
+        CHECK(wheel.Cancel(id));
+        CHECK(wheel.Size() == 0u);
+        CHECK(AdvanceTo(wheel, 100) == 0u);
+        CHECK(fired == 0);
+        CHECK_FALSE(wheel.Cancel(id));
+        CHECK_FALSE(wheel.Reschedule(id, 5ms));
+    }
+    SECTION("fired timers can't be moved or cancelled") {
+        CHECK(AdvanceTo(wheel, 10) == 1u);
+        CHECK_FALSE(wheel.Reschedule(id, 5ms));
+        CHECK_FALSE(wheel.Cancel(id));
+    }
+    SECTION("a stale id doesn't touch the timer reusing its node") {
+        CHECK(wheel.Cancel(id));
+        int reused_fired = 0;
+        const auto reused = wheel.Schedule(20ms, [&] { ++reused_fired; });
+        CHECK(reused.index == id.index);
+        CHECK_FALSE(wheel.Cancel(id));
+        CHECK_FALSE(wheel.Reschedule(id, 1ms));
+        CHECK(AdvanceTo(wheel, 20) == 1u);
+        CHECK(reused_fired == 1);
+        CHECK(fired == 0);
+    }
+    SECTION("default ids are never pending") {
+        CHECK_FALSE(wheel.Cancel(TimingWheel::TimerId{}));
+    }
+}
+
+TEST_CASE("Timeouts past the top level are clamped, not wrapped") {
+    TimingWheel wheel(1s, START);
+    wheel.Schedule(std::chrono::seconds(Ticks(4) + 10), [] {});
+    std::vector<TimingWheel::Callback> expired;
+    wheel.Advance(START + 1000s, expired);
+    CHECK(expired.empty());
+    CHECK(wheel.Size() == 1u);
+}
@@ -0,0 +1,59 @@
+#include "timeout_service.h"
+
+namespace timers {
+
+    TimeoutService::TimeoutService (net::io_context &ioc, TimingWheel::Clock::duration tick)
+            : ticker_(ioc)
+            , wheel_(tick, TimingWheel::Clock::now())
+    {}
+
+    void TimeoutService::Start () {
+        ScheduleTick();
+    }
+
+    void TimeoutService::Stop () {
+        stopped_ = true;
+        ticker_.cancel();
+    }
+
+    TimingWheel::TimerId TimeoutService::Arm (TimingWheel::Clock::duration timeout, TimingWheel::Callback callback) {
+        std::lock_guard lock(mutex_);
+        return wheel_.Schedule(timeout, std::move(callback));
+    }
+
+    bool TimeoutService::Rearm (TimingWheel::TimerId id, TimingWheel::Clock::duration timeout) {
+        std::lock_guard lock(mutex_);
+        return wheel_.Reschedule(id, timeout);
+    }
+
+    bool TimeoutService::Disarm (TimingWheel::TimerId id) {
+        std::lock_guard lock(mutex_);
+        return wheel_.Cancel(id);
+    }
+
+    size_t TimeoutService::Size () const {
+        std::lock_guard lock(mutex_);
+        return wheel_.Size();
+    }
+
+    void TimeoutService::ScheduleTick () {
+        if (stopped_) return;
+        ticker_.expires_after(wheel_.Tick());
+        ticker_.async_wait([self = shared_from_this()](const boost::system::error_code &ec) {
+            if (ec) return;
+            self->OnTick();
+        });
+    }
+
+    void TimeoutService::OnTick () {
+        {
+            std::lock_guard lock(mutex_);
+            wheel_.Advance(TimingWheel::Clock::now(), expired_);
+        }
+        // callbacks may arm timers again, so they run unlocked
+        for (auto &callback : expired_) callback();
+        expired_.clear();
+        ScheduleTick();
+    }
+
+}//!namespace
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "timing_wheel.h"
+
+// std headers go first: this Boost's asio headers use std::exchange without including <utility>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#ifndef GAME_SERVER_TIMEOUT_SERVICE_H
+#define GAME_SERVER_TIMEOUT_SERVICE_H
+
+namespace timers {
+
+    namespace net = boost::asio;
+
+    // Connection timeouts for a whole io_context: one asio timer drives one TimingWheel
+    class TimeoutService final : public std::enable_shared_from_this<TimeoutService> {
+    public:
+        TimeoutService (net::io_context &ioc, TimingWheel::Clock::duration tick);
+
+        void Start ();
+        void Stop ();
+
+        TimingWheel::TimerId Arm (TimingWheel::Clock::duration timeout, TimingWheel::Callback callback);
+        bool Rearm (TimingWheel::TimerId id, TimingWheel::Clock::duration timeout);
+        bool Disarm (TimingWheel::TimerId id);
+        size_t Size () const;
+
+    private:
+        net::steady_timer ticker_;
+        std::atomic<bool> stopped_ {false};     // Stop from a callback lands while no tick is pending
+        mutable std::mutex mutex_;
+        TimingWheel wheel_;
+        std::vector<TimingWheel::Callback> expired_;    // touched by the ticker only
+
+        void ScheduleTick ();
+        void OnTick ();
+    };
+
+}//!namespace
+
+#endif //GAME_SERVER_TIMEOUT_SERVICE_H
@@ -0,0 +1,139 @@
+#include "timing_wheel.h"
+
+#include <algorithm>
+
+namespace timers {
+
+    namespace {
+
+        const std::uint64_t SLOT_MASK = const_values::WHEEL_SLOTS - 1;
+        // the farthest expiry the top level can hold, longer timeouts are clamped to it
+        const std::uint64_t MAX_TICKS = (std::uint64_t{1} << (const_values::WHEEL_SLOT_BITS * const_values::WHEEL_LEVELS)) - 1;
+
+    }//!namespace
+
+    TimingWheel::TimingWheel (Clock::duration tick, Clock::time_point now)
+            : tick_(tick)
+            , start_(now) {
+        heads_.fill(NIL);
+    }
+
+    TimingWheel::TimerId TimingWheel::Schedule (Clock::duration timeout, Callback callback) {
+        std::uint32_t index;
+        if (not free_.empty()) {
+            index = free_.back();
+            free_.pop_back();
+        }
+        else {
+            index = static_cast<std::uint32_t>(nodes_.size());
+            nodes_.emplace_back();
+        }
+        Node &node = nodes_[index];
+        node.expires = current_ + ToTicks(timeout);
+        node.callback = std::move(callback);
+        Link(index);
+        ++size_;
+        return {index, node.generation};
+    }
+
+    bool TimingWheel::Reschedule (TimerId id, Clock::duration timeout) {
+        if (not IsPending(id)) return false;
+        Unlink(id.index);
+        nodes_[id.index].expires = current_ + ToTicks(timeout);
+        Link(id.index);
+        return true;
+    }
+
+    bool TimingWheel::Cancel (TimerId id) {
+        if (not IsPending(id)) return false;
+        Unlink(id.index);
+        Release(id.index);
+        return true;
+    }
+
+    void TimingWheel::Advance (Clock::time_point now, std::vector<Callback> &expired) {
+        if (now < start_) return;
+        const std::uint64_t target = static_cast<std::uint64_t>((now - start_) / tick_);
+        while (current_ < target) {
+            ++current_;
+            if ((current_ & SLOT_MASK) == 0) Cascade();
+            auto &head = heads_[current_ & SLOT_MASK];
+            while (head != NIL) {
+                const std::uint32_t index = head;
+                Unlink(index);
+                expired.push_back(std::move(nodes_[index].callback));
+                Release(index);
+            }
+        }
+    }
+
+    size_t TimingWheel::Size () const {
+        return size_;
+    }
+
+    TimingWheel::Clock::duration TimingWheel::Tick () const {
+        return tick_;
+    }
+
+    std::uint64_t TimingWheel::ToTicks (Clock::duration timeout) const {
+        // rounded up and at least one tick, a timer never fires early
+        const auto ticks = (timeout + tick_ - Clock::duration{1}) / tick_;
+        return std::clamp<std::uint64_t>(ticks > 0 ? static_cast<std::uint64_t>(ticks) : 0u, 1u, MAX_TICKS);
+    }
+
+    bool TimingWheel::IsPending (TimerId id) const {
+        return id.index < nodes_.size() &&
+               nodes_[id.index].generation == id.generation &&
+               nodes_[id.index].slot != NIL;
+    }
+
+    void TimingWheel::Link (std::uint32_t index) {
+        Node &node = nodes_[index];
+        const std::uint64_t delta = node.expires - current_;
+        size_t level = 0;
+        while (level + 1 < const_values::WHEEL_LEVELS &&
+               delta >= (std::uint64_t{1} << (const_values::WHEEL_SLOT_BITS * (level + 1)))) {
+            ++level;
+        }
+        const std::uint64_t slot = (node.expires >> (const_values::WHEEL_SLOT_BITS * level)) & SLOT_MASK;
+        node.slot = static_cast<std::uint32_t>(level * const_values::WHEEL_SLOTS + slot);
+        node.prev = NIL;
+        node.next = heads_[node.slot];
+        if (node.next != NIL) nodes_[node.next].prev = index;
+        heads_[node.slot] = index;
+    }
+
+    void TimingWheel::Unlink (std::uint32_t index) {
+        Node &node = nodes_[index];
+        if (node.prev != NIL) nodes_[node.prev].next = node.next;
+        else heads_[node.slot] = node.next;
+        if (node.next != NIL) nodes_[node.next].prev = node.prev;
+        node.prev = node.next = NIL;
+        node.slot = NIL;
+    }
+
+    void TimingWheel::Release (std::uint32_t index) {
+        Node &node = nodes_[index];
+        node.callback = nullptr;
+        ++node.generation;
+        free_.push_back(index);
+        --size_;
+    }
+
+    // Level 0 has wrapped: pull the timers of the next slot of each upper level down
+    void TimingWheel::Cascade () {
+        for (size_t level = 1; level < const_values::WHEEL_LEVELS; ++level) {
+            const std::uint64_t slot = (current_ >> (const_values::WHEEL_SLOT_BITS * level)) & SLOT_MASK;
+            auto &head = heads_[level * const_values::WHEEL_SLOTS + slot];
+            std::uint32_t index = head;
+            head = NIL;
+            while (index != NIL) {
+                const std::uint32_t next = nodes_[index].next;
+                Link(index);
+                index = next;
+            }
+            if (slot != 0) break;
+        }
+    }
+
+}//!namespace
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#ifndef GAME_SERVER_TIMING_WHEEL_H
+#define GAME_SERVER_TIMING_WHEEL_H
+
+namespace timers {
+
+    namespace const_values {
+        static const size_t WHEEL_LEVELS {4u};
+        static const size_t WHEEL_SLOT_BITS {8u};
+        static const size_t WHEEL_SLOTS {1u << WHEEL_SLOT_BITS};
+    }
+
+    // Hierarchical timing wheel (4 levels x 256 slots): schedule, reschedule and cancel are O(1),
+    // so idle/read timeouts of every connection don't go through a timer heap.
+    // Not thread safe; expired callbacks are handed out instead of being called,
+    // so the owner can run them after releasing its lock.
+    class TimingWheel final {
+    public:
+        using Clock = std::chrono::steady_clock;
+        using Callback = std::function<void()>;
+
+        struct TimerId {
+            std::uint32_t index {UINT32_MAX};
+            std::uint32_t generation {0};
+        };
+
+        TimingWheel (Clock::duration tick, Clock::time_point now);
+
+        TimerId Schedule (Clock::duration timeout, Callback callback);
+        // Moves a pending timer, false if it has fired or was cancelled
+        bool Reschedule (TimerId id, Clock::duration timeout);
+        bool Cancel (TimerId id);
+        // Moves callbacks of every timer expired by now into expired
+        void Advance (Clock::time_point now, std::vector<Callback> &expired);
+
+        size_t Size () const;
+        Clock::duration Tick () const;
+
+    private:
+        static constexpr std::uint32_t NIL = UINT32_MAX;
+
+        struct Node {
+            std::uint64_t expires {0};  // in ticks
+            std::uint32_t prev {NIL};
+            std::uint32_t next {NIL};
+            std::uint32_t generation {0};
+            std::uint32_t slot {NIL};   // level * WHEEL_SLOTS + slot, NIL while not linked
+            Callback callback;
+        };
+
+        const Clock::duration tick_;
+        const Clock::time_point start_;
+        std::uint64_t current_ {0};
+        size_t size_ {0};
+
+        std::vector<Node> nodes_;
+        std::vector<std::uint32_t> free_;
+        std::array<std::uint32_t, const_values::WHEEL_LEVELS * const_values::WHEEL_SLOTS> heads_;
+
+        std::uint64_t ToTicks (Clock::duration timeout) const;
+        bool IsPending (TimerId id) const;
+        void Link (std::uint32_t index);
+        void Unlink (std::uint32_t index);
+        void Release (std::uint32_t index);
+        void Cascade ();
+    };
+
+}//!namespace
+
+#endif //GAME_SERVER_TIMING_WHEEL_H
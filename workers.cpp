@@ -4,13 +4,17 @@
 
 #include "workers.h"
 #include "utils.h"
+#include "logger.h"
+#include "debug_profiler.h"
 
-#include <iostream>
+#include <algorithm>
+#include <charconv>
 
 namespace http_handler {
     namespace resources {
 
         using namespace std::string_literals;
+        using namespace std::string_view_literals;
         using namespace types::response;
 
         namespace beast = boost::beast;
@@ -19,10 +23,74 @@ namespace http_handler {
         namespace json = boost::json;
         namespace errors = http_handler::errors;
 
+        namespace {
+
+            std::vector<std::string_view> SplitList (std::string_view list, const char delim) {
+                std::vector<std::string_view> items;
+                while (not list.empty()) {
+                    const auto pos = list.find(delim);
+                    const auto item = list.substr(0, pos);
+                    if (not item.empty()) items.push_back(item);
+                    if (pos == std::string_view::npos) break;
+                    list.remove_prefix(pos + 1);
+                }
+                return items;
+            }
+
+            // "a=1&b=2" -> {a: 1, b: 2}, values are URL-decoded
+            std::unordered_map<std::string, std::string> ParseQuery (const std::string_view query) {
+                std::unordered_map<std::string, std::string> params;
+                for (const auto param : SplitList(query, '&')) {
+                    const auto eq = param.find('=');
+                    if (eq == std::string_view::npos) {
+                        params.emplace(std::string(param), ""s);
+                    }
+                    else {
+                        params.emplace(std::string(param.substr(0, eq)), utils::decodeFromURL(param.substr(eq + 1)));
+                    }
+                }
+                return params;
+            }
+
+            int IntParam (const std::unordered_map<std::string, std::string> &params,
+                          const std::string_view name,
+                          const int default_value) {
+                const auto found = params.find(std::string(name));
+                if (found == params.end()) return default_value;
+                int value = default_value;
+                const auto &str = found->second;
+                if (std::from_chars(str.data(), str.data() + str.size(), value).ec != std::errc{}) return default_value;
+                return value;
+            }
+
+            bool IsAdminRequest (const std::unordered_map<std::string, std::string> &params) {
+                const auto token = params.find(std::string(const_values::ADMIN_TOKEN_PARAM));
+                return debug::IsCompiledIn() && token != params.end() && debug::IsAdmin(token->second);
+            }
+
+        }//!namespace
+
         Workers::Workers (model::Game& game, fs::path &&root)
                 : game_(game)
                 , wwwroot_ (std::move(root))
-        {}
+                , hot_files_ (std::make_unique<io::HotFiles>(std::make_unique<io::PreadFileReader>()))
+        {
+            PrepareMapFragments();
+        }
+
+        void Workers::PrepareMapFragments () {
+            for (const auto &map : game_.GetMaps()) {
+                const json::object json_map = json_handler::MakeJson(map);
+                map_batch::Fragments fragments;
+                fragments.reserve(json_map.size());
+                for (const auto &field : json_map) {
+                    fragments.emplace_back(
+                            std::string(field.key()),
+                            serialize(json::string(field.key())) + ':' + serialize(field.value()));
+                }
+                map_fragments_.emplace(*map.GetId(), std::move(fragments));
+            }
+        }
 
         WorkerResponse Workers::SingleMap (const std::string_view data) const {
             //todo: should be redessigned once Boost 1.80 and Boost URL are in place
@@ -42,6 +110,23 @@ namespace http_handler {
             return makeResponse<Ok, StrBody, StrBodyType>(serialize(json_maps));
         }
 
+        WorkerResponse Workers::MapsBatch (const std::string_view data) const {
+            const auto params = ParseQuery(data);
+            const auto ids_param = params.find(std::string(const_values::BATCH_IDS_PARAM));
+            if (ids_param == params.end()) return BadRequest(data);
+            const auto ids = SplitList(ids_param->second, const_values::BATCH_LIST_DELIM);
+            if (ids.empty() || ids.size() > const_values::MAX_BATCH_MAPS) return BadRequest(data);
+
+            std::vector<std::string_view> fields;  // empty - all of them
+            if (auto fields_param = params.find(std::string(const_values::BATCH_FIELDS_PARAM));
+                    fields_param != params.end()) {
+                fields = SplitList(fields_param->second, const_values::BATCH_LIST_DELIM);
+            }
+            auto body = map_batch::Assemble(map_fragments_, ids, fields);
+            if (not body) return MapNotFound(data);
+            return makeResponse<Ok, StrBody, StrBodyType>(std::move(*body));
+        }
+
         WorkerResponse Workers::MapNotFound ([[maybe_unused]] const std::string_view data) const {
             return makeResponse<NotFound, StrBody, StrBodyType>(serialize(errors::MAP_NOT_FOUND)); //todo: stupid work
         }
@@ -55,16 +140,23 @@ namespace http_handler {
             fs::path requested_file_path = wwwroot_;
             requested_file_path += fs::path(utils::decodeFromURL(data));
             fs::path path_to_check =  fs::weakly_canonical(wwwroot_ / requested_file_path);
-            std::cerr << wwwroot_ << '\n' << requested_file_path  << '\n' << path_to_check << '\n';
+            logging::Log(logging::Level::Debug, "file request"sv,
+                         logging::Kv("root"sv, wwwroot_),
+                         logging::Kv("requested"sv, requested_file_path),
+                         logging::Kv("resolved"sv, path_to_check));
 
             if (not utils::IsSubPath(path_to_check, wwwroot_)) {
                 return FileNotFound(data);
             }
+            if (auto cached = hot_files_->Find(requested_file_path); cached) {
+                return makeResponse<Ok, SharedStrBody, SharedStrBodyType>(std::move(cached));
+            }
             http::file_body::value_type file;
             if (sys::error_code ec; file.open(requested_file_path.c_str(), beast::file_mode::read, ec), ec) {
                 return FileNotFound(data);
             }
             else {
+                hot_files_->Touch(requested_file_path);
                 return makeResponse<Ok, FileBody, FileBodyType>(std::move(file));
             }
         }
@@ -77,6 +169,69 @@ namespace http_handler {
             return makeResponse<NotFound, StrBody, StrBodyType>(serialize(errors::OBJECT_NOT_FOUND)); //todo: stupid work
         }
 
+        WorkerResponse Workers::DebugCpuProfile (const std::string_view data) const {
+            const auto params = ParseQuery(data);
+            if (not IsAdminRequest(params)) return ObjectNotFound(data);
+            if (params.count(std::string(const_values::PROFILE_COLLECT_PARAM))) {
+                std::string profile;
+                const auto state = debug::CollectCpuProfile(profile);
+                return ProfileResponse(state, std::move(profile), const_values::TEXT_PLAIN);
+            }
+            const int seconds = std::clamp(
+                    IntParam(params, const_values::PROFILE_SECONDS_PARAM, const_values::DEFAULT_PROFILE_SECONDS),
+                    1, static_cast<int>(debug::const_values::MAX_PROFILE_DURATION.count()));
+            const auto started = debug::StartCpuProfile(
+                    std::chrono::seconds(seconds),
+                    IntParam(params, const_values::PROFILE_FREQUENCY_PARAM, debug::const_values::DEFAULT_CPU_FREQUENCY));
+            return ProfileResponse(started, seconds);
+        }
+
+        WorkerResponse Workers::DebugAllocations (const std::string_view data) const {
+            const auto params = ParseQuery(data);
+            if (not IsAdminRequest(params)) return ObjectNotFound(data);
+            if (params.count(std::string(const_values::PROFILE_COLLECT_PARAM))) {
+                std::string profile;
+                const auto state = debug::CollectAllocationProfile(profile);
+                return ProfileResponse(state, std::move(profile), const_values::APPLICATION_JSON);
+            }
+            const int seconds = std::clamp(
+                    IntParam(params, const_values::PROFILE_SECONDS_PARAM, const_values::DEFAULT_PROFILE_SECONDS),
+                    1, static_cast<int>(debug::const_values::MAX_PROFILE_DURATION.count()));
+            return ProfileResponse(debug::StartAllocationProfile(std::chrono::seconds(seconds)), seconds);
+        }
+
+        WorkerResponse Workers::ProfileResponse (debug::StartResult started, const int seconds) const {
+            switch (started) {
+                case debug::StartResult::Started:
+                    return makeResponse<Accepted, StrBody, StrBodyType>(
+                            R"({"status":"started","seconds":)" + std::to_string(seconds) + '}');
+                case debug::StartResult::Busy:
+                    return makeResponse<BadRequest_, StrBody, StrBodyType>(
+                            R"({"code":"profileRunning","message":"Another profile is running"})"s);
+                case debug::StartResult::Failed:
+                    return makeResponse<InternalError, StrBody, StrBodyType>(
+                            R"({"code":"profileFailed","message":"Profiler setup failed, see the log"})"s);
+                default:
+                    return ObjectNotFound({});
+            }
+        }
+
+        WorkerResponse Workers::ProfileResponse (debug::ProfileState state,
+                                                 std::string &&result,
+                                                 const std::string_view content_type) const {
+            switch (state) {
+                case debug::ProfileState::Ready: {
+                    auto response = makeResponse<Ok, StrBody, StrBodyType>(std::move(result));
+                    response.As<Str>().set(http::field::content_type, content_type);
+                    return response;
+                }
+                case debug::ProfileState::Running:
+                    return makeResponse<Accepted, StrBody, StrBodyType>(R"({"status":"running"})"s);
+                default:
+                    return ObjectNotFound({});
+            }
+        }
+
         std::unordered_map<
                 WorkerCallerId,
                 WorkerResponse ((Workers::*)(const std::string_view data) const)
@@ -9,14 +9,20 @@
 #include "errors.h"
 #include "object_holder.h"
 #include "http_response_type.h"
+#include "hot_files.h"
+#include "map_batch.h"
+#include "debug_profiler.h"
 
 #include <boost/beast/http.hpp>
 #include <boost/beast/core.hpp>
 
 #include <functional>
+#include <memory>
 #include <variant>
 #include <string>
 #include <filesystem>
+#include <unordered_map>
+#include <vector>
 
 #ifndef GAME_SERVER_WORKERS_H
 #define GAME_SERVER_WORKERS_H
@@ -30,6 +36,20 @@ namespace http_handler {
         using WorkerResponse = types::HttpResponse;
         using WorkerCallerId = std::string;
 
+        namespace const_values {
+            static const size_t MAX_BATCH_MAPS {64u};
+            static const std::string_view BATCH_IDS_PARAM {"ids"};
+            static const std::string_view BATCH_FIELDS_PARAM {"fields"};
+            static const char BATCH_LIST_DELIM = ',';
+            static const std::string_view ADMIN_TOKEN_PARAM {"token"};
+            static const std::string_view PROFILE_SECONDS_PARAM {"seconds"};
+            static const std::string_view PROFILE_FREQUENCY_PARAM {"frequency"};
+            static const std::string_view PROFILE_COLLECT_PARAM {"collect"};
+            static const int DEFAULT_PROFILE_SECONDS {10};
+            static const std::string_view TEXT_PLAIN {"text/plain"};
+            static const std::string_view APPLICATION_JSON {"application/json"};
+        }
+
         class Workers final {
         public:
             Workers (model::Game& game, fs::path &&root);
@@ -39,25 +59,45 @@ namespace http_handler {
 
             WorkerResponse SingleMap (const std::string_view data) const;
             WorkerResponse AllMaps (const std::string_view data) const;
+            // data: "ids=map1,map2[&fields=id,name]"
+            WorkerResponse MapsBatch (const std::string_view data) const;
             WorkerResponse MapNotFound (const std::string_view data) const;
             WorkerResponse BadRequest (const std::string_view data) const;
             WorkerResponse File (const std::string_view data) const;
             WorkerResponse FileNotFound (const std::string_view data) const;
             WorkerResponse ObjectNotFound (const std::string_view data) const;
+            // admin only, starts a profile with "token=...[&seconds=10][&frequency=99]" (202),
+            // "token=...&collect" gets its result (200), 202 while it is still running.
+            // The token comes in the query string (workers don't see headers), so it ends up
+            // in proxy and access logs: keep these routes off public listeners.
+            WorkerResponse DebugCpuProfile (const std::string_view data) const;
+            // admin only, "token=...[&seconds=10]" / "token=...&collect" as for DebugCpuProfile
+            WorkerResponse DebugAllocations (const std::string_view data) const;
 
         private:
             model::Game game_;
             const fs::path wwwroot_;
+            std::unique_ptr<io::HotFiles> hot_files_;
+
+            // batch responses are glued from these
+            map_batch::FragmentsById map_fragments_;
+
+            void PrepareMapFragments ();
+            // shared by the profiling routes
+            WorkerResponse ProfileResponse (debug::StartResult started, const int seconds) const;
+            WorkerResponse ProfileResponse (debug::ProfileState state, std::string &&result, const std::string_view content_type) const;
 
             struct Ok {};
             struct BadRequest_ {};
             struct NotFound {};
+            struct Accepted {};
+            struct InternalError {};
 
             template <typename Status, typename Body, typename BodyType>
             WorkerResponse makeResponse (BodyType &&body) const;
 
             template <typename Body>
-            WorkerResponse wrapIt (http::response<Body> &&res) const;
+            WorkerResponse wrapIt (http::response<Body, types::response::Fields> &&res) const;
 
             //todo: another option to organize workers, keeping that for a while
             static std::unordered_map<
@@ -68,7 +108,7 @@ namespace http_handler {
 
         template <typename Status, typename Body, typename BodyType>
         WorkerResponse Workers::makeResponse (BodyType &&body) const {
-            http::response<Body> res;
+            http::response<Body, types::response::Fields> res;
             res.body() = std::forward<BodyType>(body);
 
             if constexpr (std::is_same_v<Ok, Status>) {
@@ -80,6 +120,12 @@ namespace http_handler {
             else if constexpr (std::is_same_v<NotFound, Status>) {
                 res.result(http::status::not_found);
             }
+            else if constexpr (std::is_same_v<Accepted, Status>) {
+                res.result(http::status::accepted);
+            }
+            else if constexpr (std::is_same_v<InternalError, Status>) {
+                res.result(http::status::internal_server_error);
+            }
             else {
                 throw std::runtime_error ("unknown response status");
             }
@@ -90,13 +136,14 @@ namespace http_handler {
 
 
         template <typename Body>
-        WorkerResponse Workers::wrapIt (http::response<Body> &&res) const {
+        WorkerResponse Workers::wrapIt (http::response<Body, types::response::Fields> &&res) const {
             using namespace types::response;
             if constexpr (
                     std::disjunction_v<
                             std::is_same<StrBody, Body>,
                             std::is_same<FileBody, Body>,
-                            std::is_same<EmptyBody, Body>
+                            std::is_same<EmptyBody, Body>,
+                            std::is_same<SharedStrBody, Body>
                     >
                     ) {
                 return {std::move(res)};